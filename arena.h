@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+// Four packed vertices of one quad, the unit the mesher writes in
+typedef struct {
+    uint32_t vertices[4];
+} Quad;
+
+// Scratch space for building a mesh. Each remesh worker allocates one at the largest size a
+// section mesh can reach, then resets and reuses it, so appending never reallocates.
+typedef struct {
+    Quad *quads;
+    size_t count;
+    size_t capacity;
+} MeshArena;
+
+MeshArena newMeshArena(size_t capacity) {
+    MeshArena arena;
+    arena.quads = (Quad*)malloc(capacity * sizeof(Quad));
+    arena.count = 0;
+    arena.capacity = capacity;
+    return arena;
+}
+
+void resetMeshArena(MeshArena *arena) {
+    arena->count = 0;
+}
+
+// Reserves space for count quads and returns it for the caller to fill
+Quad *appendQuads(MeshArena *arena, size_t count) {
+    assert(arena->count + count <= arena->capacity);
+    Quad *quads = arena->quads + arena->count;
+    arena->count += count;
+    return quads;
+}
+
+void freeMeshArena(MeshArena *arena) {
+    free(arena->quads);
+    arena->quads = NULL;
+    arena->count = 0;
+    arena->capacity = 0;
+}
\ No newline at end of file
@@ -0,0 +1,317 @@
+// Headless check that greedy meshing covers exactly the faces a plain mesher emitting one quad per
+// exposed face would. Every section of a few worlds is meshed the way the remesh workers do, the
+// quads are expanded back into unit faces, and those are compared with the faces found by walking
+// the world block by block through GetBlock and GetLight:
+//
+//   cc -O2 -I.. facecheck.c -o facecheck -lm
+//   ./facecheck
+//
+// Worlds: the flat world LoadWorld generates around spawn, random noise with sprites, a 3D
+// checkerboard, and blocks along section and chunk borders with a few glowing ones among them.
+// All are lit like LoadChunk lights them, so faces have to agree on light as well as tile.
+// Exits with 1 when any face is missing, doubled, or has the wrong tile or light.
+
+#include <math.h>
+
+#define PROFILE_ZONE(name)
+#include "arena.h"
+#include "sprites.h"
+#include "palette.h"
+#include "world.h"
+#include "light.h"
+#include "mesher.h"
+
+#define MAX_WORLDS 4
+#define MAX_REPORTED 8
+
+typedef struct {
+    int face;
+    int x, y, z;  // Block the face belongs to
+    int tile;
+    int light;
+} UnitFace;
+
+typedef struct {
+    UnitFace *faces;
+    long count;
+    long capacity;
+} FaceList;
+
+// Outward normal of each face, +Z, -Z, +Y, -Y, +X, -X
+static const int faceNormals[6][3] = { { 0, 0, 1 }, { 0, 0, -1 }, { 0, 1, 0 }, { 0, -1, 0 }, { 1, 0, 0 }, { -1, 0, 0 } };
+
+static void AddFace(FaceList *list, int face, int x, int y, int z, int tile, int light) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 1 << 16;
+        list->faces = (UnitFace*)realloc(list->faces, list->capacity * sizeof(UnitFace));
+    }
+    list->faces[list->count++] = (UnitFace){ face, x, y, z, tile & 0xFF, light };
+}
+
+static int CompareFaces(const void *a, const void *b) {
+    const UnitFace *p = (const UnitFace*)a, *q = (const UnitFace*)b;
+    const int u[6] = { p->x, p->y, p->z, p->face, p->tile, p->light };
+    const int v[6] = { q->x, q->y, q->z, q->face, q->tile, q->light };
+    for (int i = 0; i < 6; i++) {
+        if (u[i] != v[i]) return u[i] < v[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+static int BrightestLight(uint8_t light) {
+    int sky = light >> LIGHT_SKY_SHIFT, block = light & LIGHT_MAX;
+    return sky > block ? sky : block;
+}
+
+static Chunk *AddChunk(ChunkMap *map, int cx, int cy, int cz) {
+    Chunk *chunk = NewChunk(map, cx, cy, cz);
+    PackedBlocksInit(&chunk->blocks, CHUNK_VOLUME, 0);
+    ChunkMapInsert(map, chunk);
+    return chunk;
+}
+
+// The chunks LoadWorld brings in around the spawn point, LOAD_RADIUS 1
+void BuildFlatWorld(ChunkMap *map) {
+    for (int cz = -1; cz <= 1; cz++) {
+        for (int cy = -1; cy <= 1; cy++) {
+            for (int cx = -1; cx <= 1; cx++) {
+                GenerateChunk(AddChunk(map, cx, cy, cz));
+            }
+        }
+    }
+}
+
+// One chunk of uniform noise: half air, the rest spread over four block ids and a few sprites
+void BuildNoiseWorld(ChunkMap *map) {
+    Chunk *chunk = AddChunk(map, 0, 0, 0);
+    srand(1);
+
+    for (int i = 0; i < CHUNK_VOLUME; i++) {
+        int r = rand() % 64;
+        int id = r < 32 ? 0 : r < 62 ? 1 + r % 4 : -(1 + r % 5);
+        if (id != 0) PackedBlocksSet(&chunk->blocks, i, id);
+    }
+}
+
+// One chunk where every other block is solid, so every face is exposed and no two faces merge
+void BuildCheckerboardWorld(ChunkMap *map) {
+    Chunk *chunk = AddChunk(map, 0, 0, 0);
+
+    for (int z = 0; z < CHUNK_SIZE; z++) {
+        for (int y = 0; y < CHUNK_SIZE; y++) {
+            for (int x = 0; x < CHUNK_SIZE; x++) {
+                if ((x + y + z) & 1) PackedBlocksSet(&chunk->blocks, ChunkIndex(x, y, z), 1 + (x + z) % 4);
+            }
+        }
+    }
+}
+
+// Two chunks side by side with blocks only in the first and last layer of each section, so faces
+// meet at section and chunk borders where the snapshot border and the column end bits matter.
+// A few glowstone blocks give the light something to vary.
+void BuildEdgeWorld(ChunkMap *map) {
+    srand(2);
+    for (int cx = 0; cx < 2; cx++) {
+        Chunk *chunk = AddChunk(map, cx, 0, 0);
+
+        for (int z = 0; z < CHUNK_SIZE; z++) {
+            for (int y = 0; y < CHUNK_SIZE; y++) {
+                for (int x = 0; x < CHUNK_SIZE; x++) {
+                    int lx = x % SECTION_SIZE, ly = y % SECTION_SIZE, lz = z % SECTION_SIZE;
+                    bool edge = lx == 0 || lx == SECTION_SIZE - 1 || ly == 0 || ly == SECTION_SIZE - 1 || lz == 0 || lz == SECTION_SIZE - 1;
+                    if (!edge || rand() % 3 == 0) continue;
+
+                    int r = rand() % 200;
+                    int id = r == 0 ? 56 : r < 5 ? -(1 + r) : 1 + r % 3;
+                    PackedBlocksSet(&chunk->blocks, ChunkIndex(x, y, z), id);
+                }
+            }
+        }
+    }
+}
+
+// Lights the chunks top down, the order UpdateLoadedChunks loads them in
+void LightWorld(ChunkMap *map, LightEngine *engine) {
+    int cyMin = INT32_MAX, cyMax = INT32_MIN;
+    for (int i = 0; i < map->capacity; i++) {
+        Chunk *chunk = map->slots[i].chunk;
+        if (chunk == NULL) continue;
+        RebuildChunkSprites(chunk);
+        RebuildChunkOccupancy(chunk);
+        cyMin = chunk->cy < cyMin ? chunk->cy : cyMin;
+        cyMax = chunk->cy > cyMax ? chunk->cy : cyMax;
+    }
+
+    for (int cy = cyMax; cy >= cyMin; cy--) {
+        for (int i = 0; i < map->capacity; i++) {
+            Chunk *chunk = map->slots[i].chunk;
+            if (chunk != NULL && chunk->cy == cy) LightChunk(engine, map, chunk);
+        }
+    }
+    LightClearSections(engine, map);
+}
+
+// Every quad of every section of the world, expanded into unit faces
+void GreedyFaces(ChunkMap *map, FaceList *list) {
+    GreedyMesher *mesher = (GreedyMesher*)malloc(sizeof(GreedyMesher));
+    SectionSnapshot *snapshot = (SectionSnapshot*)malloc(sizeof(SectionSnapshot));
+    MeshArena arena = newMeshArena(MAX_SECTION_QUADS + MAX_SECTION_SPRITE_QUADS);
+
+    for (int i = 0; i < map->capacity; i++) {
+        Chunk *chunk = map->slots[i].chunk;
+        if (chunk == NULL) continue;
+
+        for (int s = 0; s < SECTION_COUNT; s++) {
+            int sx = chunk->cx * SECTIONS_PER_AXIS + s % SECTIONS_PER_AXIS;
+            int sy = chunk->cy * SECTIONS_PER_AXIS + s / SECTIONS_PER_AXIS % SECTIONS_PER_AXIS;
+            int sz = chunk->cz * SECTIONS_PER_AXIS + s / (SECTIONS_PER_AXIS * SECTIONS_PER_AXIS);
+
+            TakeSectionSnapshot(snapshot, map, sx, sy, sz);
+            resetMeshArena(&arena);
+            CountSectionMesh(mesher, snapshot);
+            EmitSectionMesh(mesher, snapshot, &arena);
+            const Quad *quads = arena.quads;
+
+            for (int q = 0; q < (int)arena.count; q++) {
+                int lo[3] = { 31, 31, 31 }, hi[3] = { 0, 0, 0 };
+                for (int corner = 0; corner < 4; corner++) {
+                    uint32_t vertex = quads[q].vertices[corner];
+                    int p[3] = { vertex & 31, vertex >> 5 & 31, vertex >> 10 & 31 };
+                    for (int axis = 0; axis < 3; axis++) {
+                        lo[axis] = p[axis] < lo[axis] ? p[axis] : lo[axis];
+                        hi[axis] = p[axis] > hi[axis] ? p[axis] : hi[axis];
+                    }
+                }
+
+                uint32_t vertex = quads[q].vertices[0];
+                int face = vertex >> 15 & 7;
+                int tile = vertex >> 20 & 0xFF;
+                int light = vertex >> 28;
+
+                // Block faces are flat along their axis and sit on the far side for positive faces
+                if (face < 6) {
+                    int axis = 2 - face / 2;
+                    if (face % 2 == 0) lo[axis]--;
+                    hi[axis] = lo[axis] + 1;
+                }
+
+                for (int z = lo[2]; z < hi[2]; z++) {
+                    for (int y = lo[1]; y < hi[1]; y++) {
+                        for (int x = lo[0]; x < hi[0]; x++) {
+                            AddFace(list, face, sx * SECTION_SIZE + x, sy * SECTION_SIZE + y, sz * SECTION_SIZE + z, tile, light);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    freeMeshArena(&arena);
+    free(snapshot);
+    free(mesher);
+}
+
+// One face per solid block side that borders air or a sprite, two per sprite block
+void PlainFaces(ChunkMap *map, FaceList *list) {
+    for (int i = 0; i < map->capacity; i++) {
+        Chunk *chunk = map->slots[i].chunk;
+        if (chunk == NULL) continue;
+
+        int ox = chunk->cx * CHUNK_SIZE, oy = chunk->cy * CHUNK_SIZE, oz = chunk->cz * CHUNK_SIZE;
+        for (int z = oz; z < oz + CHUNK_SIZE; z++) {
+            for (int y = oy; y < oy + CHUNK_SIZE; y++) {
+                for (int x = ox; x < ox + CHUNK_SIZE; x++) {
+                    int id = GetBlock(map, x, y, z);
+
+                    if (id < 0) {
+                        int light = BrightestLight(GetLight(map, x, y, z));
+                        AddFace(list, SPRITE_FACE_A, x, y, z, SpriteTile(id), light);
+                        AddFace(list, SPRITE_FACE_B, x, y, z, SpriteTile(id), light);
+                        continue;
+                    }
+                    if (id == 0) continue;
+
+                    for (int face = 0; face < 6; face++) {
+                        int nx = x + faceNormals[face][0], ny = y + faceNormals[face][1], nz = z + faceNormals[face][2];
+                        if (GetBlock(map, nx, ny, nz) > 0) continue;
+                        AddFace(list, face, x, y, z, id - 1, BrightestLight(GetLight(map, nx, ny, nz)));
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void PrintFace(const char *what, const UnitFace *face) {
+    fprintf(stderr, "    %s face %d of block %d %d %d, tile %d, light %d\n", what, face->face, face->x, face->y, face->z, face->tile, face->light);
+}
+
+// Both lists sorted. Returns the number of faces in only one of them.
+long CompareFaceLists(const FaceList *greedy, const FaceList *plain) {
+    long i = 0, j = 0, differences = 0;
+
+    while (i < greedy->count || j < plain->count) {
+        int order = i == greedy->count ? 1 : j == plain->count ? -1 : CompareFaces(&greedy->faces[i], &plain->faces[j]);
+        if (order == 0) {
+            i++;
+            j++;
+            continue;
+        }
+
+        if (differences < MAX_REPORTED) PrintFace(order < 0 ? "extra" : "missing", order < 0 ? &greedy->faces[i] : &plain->faces[j]);
+        differences++;
+        if (order < 0) i++;
+        else j++;
+    }
+    return differences;
+}
+
+void FreeWorld(ChunkMap *map) {
+    for (int i = 0; i < map->capacity; i++) {
+        if (map->slots[i].chunk != NULL) FreeChunk(map->slots[i].chunk);
+    }
+    free(map->slots);
+}
+
+int main() {
+    const char *names[MAX_WORLDS] = { "flat", "noise", "checkerboard", "edge" };
+    LightEngine engine = { 0 };
+    bool same = true;
+
+    printf("{\n");
+    printf("  \"worlds\": [\n");
+    for (int world = 0; world < MAX_WORLDS; world++) {
+        ChunkMap map;
+        ChunkMapInit(&map, 64);
+
+        switch (world) {
+            case 0: BuildFlatWorld(&map); break;
+            case 1: BuildNoiseWorld(&map); break;
+            case 2: BuildCheckerboardWorld(&map); break;
+            case 3: BuildEdgeWorld(&map); break;
+        }
+        LightWorld(&map, &engine);
+
+        FaceList greedy = { 0 }, plain = { 0 };
+        GreedyFaces(&map, &greedy);
+        PlainFaces(&map, &plain);
+        qsort(greedy.faces, greedy.count, sizeof(UnitFace), CompareFaces);
+        qsort(plain.faces, plain.count, sizeof(UnitFace), CompareFaces);
+
+        if (greedy.count != plain.count || CompareFaceLists(&greedy, &plain) > 0) {
+            fprintf(stderr, "%s: greedy faces differ from the plain mesher\n", names[world]);
+            same = false;
+        }
+
+        printf("    { \"name\": \"%s\", \"greedyFaces\": %ld, \"plainFaces\": %ld }%s\n", names[world], greedy.count, plain.count, world + 1 < MAX_WORLDS ? "," : "");
+
+        free(greedy.faces);
+        free(plain.faces);
+        FreeWorld(&map);
+    }
+    printf("  ]\n");
+    printf("}\n");
+
+    LightEngineFree(&engine);
+    return same ? 0 : 1;
+}
\ No newline at end of file
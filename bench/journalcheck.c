@@ -0,0 +1,141 @@
+// Headless check of journal checkpoints around a failed save. Drives the journal and the save queue
+// the way the game loop does, in a scratch directory:
+//
+//   cc -O2 -I.. journalcheck.c -o journalcheck -lpthread -lm
+//   ./journalcheck
+//
+// The first save fails, a directory sits where its temporary region file goes, so journal.old has
+// to stay. The next save writes the chunk again and has to delete journal.old, and the save after
+// that has to rotate the journal again. Exits with 1 when any step leaves the wrong files behind.
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The profiler draws with raylib, the workers' zones are not needed here
+typedef struct {
+    const char *name;
+} ProfileZone;
+
+static inline void ProfileThreadName(const char *name) { (void)name; }
+static inline ProfileZone ProfileBegin(const char *name) { return (ProfileZone){ name }; }
+static inline void ProfileEnd(ProfileZone *zone) { (void)zone; }
+
+#include "cpu.h"
+#include "arena.h"
+#include "sprites.h"
+#include "palette.h"
+#include "world.h"
+#include "codec.h"
+#include "mapfile.h"
+#include "crc32c.h"
+#include "region.h"
+#include "thread.h"
+#include "save.h"
+#include "journal.h"
+
+#define CHECK_DIRECTORY "journalcheck.tmp"
+#define BLOCKED_NAME "region.0.0.0.tmp"
+
+ChunkMap chunks;
+SaveQueue saveQueue;
+Journal journal;
+unsigned int edits = 0;
+
+void EditBlock(int x, int y, int z, int id) {
+    int oldId = GetBlock(&chunks, x, y, z);
+    SetBlock(&chunks, x, y, z, id);
+    JournalAppend(&journal, x, y, z, oldId, id, edits++);
+}
+
+// Like SaveWorld and the SaveQueuePoll step of the game loop, run until the queue is idle
+void SaveAndWait() {
+    JournalCheckpoint(&journal);
+    for (int i = 0; i < chunks.capacity; i++) {
+        Chunk *chunk = chunks.slots[i].chunk;
+        if (chunk != NULL && chunk->dirty) SaveQueueSubmit(&saveQueue, &chunks, chunk->cx, chunk->cy, chunk->cz);
+    }
+
+    while (true) {
+        if (SaveQueuePoll(&saveQueue, &chunks) > 0) journal.saveFailed = true;
+        if (SaveQueueIdle(&saveQueue)) break;
+        usleep(1000);
+    }
+    JournalSavesFinished(&journal);
+    JournalFlush(&journal);
+}
+
+bool FileExists(const char *name) {
+    FILE *file = fopen(name, "rb");
+    if (file != NULL) fclose(file);
+    return file != NULL;
+}
+
+bool Expect(const char *step, bool regionSaved, bool oldExists, int records) {
+    int count;
+    free(JournalRead(&count));
+
+    bool saved = FileExists("region.0.0.0");
+    bool old = FileExists(JOURNAL_OLD_NAME);
+    bool passed = saved == regionSaved && old == oldExists && count == records;
+
+    printf("    { \"step\": \"%s\", \"regionSaved\": %s, \"journalOld\": %s, \"records\": %d, \"passed\": %s },\n",
+        step, saved ? "true" : "false", old ? "true" : "false", count, passed ? "true" : "false");
+    return passed;
+}
+
+int main() {
+    mkdir(CHECK_DIRECTORY, 0755);
+    if (chdir(CHECK_DIRECTORY) != 0) {
+        fprintf(stderr, "Cannot enter %s\n", CHECK_DIRECTORY);
+        return 2;
+    }
+    remove("region.0.0.0");
+    remove(JOURNAL_NAME);
+    remove(JOURNAL_OLD_NAME);
+    rmdir(BLOCKED_NAME);
+
+    CpuInit();
+    Crc32cInit();
+    ChunkMapInit(&chunks, 16);
+    Chunk *chunk = NewChunk(&chunks, 0, 0, 0);
+    GenerateChunk(chunk);
+    RebuildChunkSprites(chunk);
+    RebuildChunkOccupancy(chunk);
+    ChunkMapInsert(&chunks, chunk);
+
+    SaveQueueInit(&saveQueue);
+    JournalInit(&journal);
+    bool passed = true;
+
+    printf("{\n");
+    printf("  \"steps\": [\n");
+
+    EditBlock(1, 10, 1, 1);
+    mkdir(BLOCKED_NAME, 0755);
+    SaveAndWait();
+    passed &= Expect("failed save", false, true, 1);
+
+    rmdir(BLOCKED_NAME);
+    EditBlock(2, 10, 2, 1);
+    SaveAndWait();
+    passed &= Expect("retried save", true, false, 1);
+
+    EditBlock(3, 10, 3, 1);
+    SaveAndWait();
+    passed &= Expect("next save", true, false, 0);
+
+    printf("    { \"step\": \"done\", \"passed\": %s }\n", passed ? "true" : "false");
+    printf("  ]\n");
+    printf("}\n");
+
+    JournalShutdown(&journal);
+    SaveQueueShutdown(&saveQueue, &chunks);
+    FreeChunk(chunk);
+    free(chunks.slots);
+
+    remove("region.0.0.0");
+    remove(JOURNAL_NAME);
+    remove(JOURNAL_OLD_NAME);
+    if (chdir("..") == 0) rmdir(CHECK_DIRECTORY);
+    return passed ? 0 : 1;
+}
\ No newline at end of file
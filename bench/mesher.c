@@ -0,0 +1,373 @@
+// Headless mesher benchmark. Remeshes every section of a few canonical worlds the way the remesh
+// workers do (snapshot, count, emit into a reused arena, copy at the exact size) and prints the results as JSON. Needs no
+// window or GPU, only the headers:
+//
+//   cc -O2 -I.. mesher.c -o mesher -lpthread -lm
+//   ./mesher > baseline.json
+//
+// Worlds: the flat world LoadWorld generates around spawn, random noise, a 3D checkerboard (the
+// worst case, nothing merges) and the saved world around spawn, read from the region files in the
+// directory given with --saved (default ../bin, where the game saves), skipped when there is no save.
+//
+// The worlds are lit like LoadChunk lights them, so merging only faces of equal light is measured.
+// Each world also reports faceHash, a hash of the unit faces the quads cover, with their tile and
+// light, that does not depend on quad order or on how faces were merged. Running a changed mesher with --check baseline.json
+// compares it against a baseline and exits with 1 when any world renders differently.
+
+#include <time.h>
+#include <math.h>
+
+#define PROFILE_ZONE(name)
+#include "cpu.h"
+#include "arena.h"
+#include "sprites.h"
+#include "palette.h"
+#include "world.h"
+#include "light.h"
+#include "codec.h"
+#include "mapfile.h"
+#include "crc32c.h"
+#include "region.h"
+#include "mesher.h"
+
+#define MESH_ROUNDS 8
+#define MAX_WORLDS 4
+
+typedef struct {
+    const char *name;
+    int chunks;
+    int sections;
+    double bestTime;  // Seconds for one pass over every section, best of MESH_ROUNDS
+    long faces;
+    long quads;
+    long spriteQuads;
+    long bytesAllocated;  // Vertex memory the workers would allocate for one pass
+    uint64_t faceHash;
+} WorldResult;
+
+double Now() {
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static Chunk *AddChunk(ChunkMap *map, int cx, int cy, int cz) {
+    Chunk *chunk = NewChunk(map, cx, cy, cz);
+    PackedBlocksInit(&chunk->blocks, CHUNK_VOLUME, 0);
+    ChunkMapInsert(map, chunk);
+    return chunk;
+}
+
+// The chunks LoadWorld brings in around the spawn point, LOAD_RADIUS 1
+void BuildFlatWorld(ChunkMap *map) {
+    for (int cz = -1; cz <= 1; cz++) {
+        for (int cy = -1; cy <= 1; cy++) {
+            for (int cx = -1; cx <= 1; cx++) {
+                Chunk *chunk = NewChunk(map, cx, cy, cz);
+                GenerateChunk(chunk);
+                ChunkMapInsert(map, chunk);
+            }
+        }
+    }
+}
+
+// One chunk of uniform noise: half air, the rest spread over four block ids and a few sprites
+void BuildNoiseWorld(ChunkMap *map) {
+    Chunk *chunk = AddChunk(map, 0, 0, 0);
+    srand(1);
+
+    for (int i = 0; i < CHUNK_VOLUME; i++) {
+        int r = rand() % 64;
+        int id = r < 32 ? 0 : r < 62 ? 1 + r % 4 : -(1 + r % 5);
+        if (id != 0) PackedBlocksSet(&chunk->blocks, i, id);
+    }
+}
+
+// One chunk where every other block is solid, so every face is exposed and no two faces merge
+void BuildCheckerboardWorld(ChunkMap *map) {
+    Chunk *chunk = AddChunk(map, 0, 0, 0);
+
+    for (int z = 0; z < CHUNK_SIZE; z++) {
+        for (int y = 0; y < CHUNK_SIZE; y++) {
+            for (int x = 0; x < CHUNK_SIZE; x++) {
+                if ((x + y + z) & 1) PackedBlocksSet(&chunk->blocks, ChunkIndex(x, y, z), 1 + (x + z) % 4);
+            }
+        }
+    }
+}
+
+// The saved chunks around spawn, the others generated like LoadChunk does. False when nothing was saved.
+bool BuildSavedWorld(ChunkMap *map, const char *directory) {
+    char previous[4096];
+    if (getcwd(previous, sizeof(previous)) == NULL || chdir(directory) != 0) return false;
+
+    int saved = 0;
+    for (int cz = -1; cz <= 1; cz++) {
+        for (int cy = -1; cy <= 1; cy++) {
+            for (int cx = -1; cx <= 1; cx++) {
+                Chunk *chunk = NewChunk(map, cx, cy, cz);
+                if (LoadChunkFile(chunk, true)) saved++;
+                else GenerateChunk(chunk);
+                ChunkMapInsert(map, chunk);
+            }
+        }
+    }
+    UnmapAllRegions();
+
+    chdir(previous);
+    return saved > 0;
+}
+
+// Lights the chunks top down, the order UpdateLoadedChunks loads them in
+void LightWorld(ChunkMap *map, LightEngine *engine) {
+    int cyMin = INT32_MAX, cyMax = INT32_MIN;
+    for (int i = 0; i < map->capacity; i++) {
+        Chunk *chunk = map->slots[i].chunk;
+        if (chunk == NULL) continue;
+        RebuildChunkSprites(chunk);
+        RebuildChunkOccupancy(chunk);
+        cyMin = chunk->cy < cyMin ? chunk->cy : cyMin;
+        cyMax = chunk->cy > cyMax ? chunk->cy : cyMax;
+    }
+
+    for (int cy = cyMax; cy >= cyMin; cy--) {
+        for (int i = 0; i < map->capacity; i++) {
+            Chunk *chunk = map->slots[i].chunk;
+            if (chunk != NULL && chunk->cy == cy) LightChunk(engine, map, chunk);
+        }
+    }
+    LightClearSections(engine, map);
+}
+
+// Order independent hash of one unit face, summed over every face a quad covers
+static inline uint64_t FaceHash(int face, int x, int y, int z, int tile, int light) {
+    uint64_t h = (uint64_t)face | (uint64_t)(x & 0xFF) << 8 | (uint64_t)(y & 0xFF) << 16 | (uint64_t)(z & 0xFF) << 24 | (uint64_t)(tile & 0xFF) << 32 | (uint64_t)(light & LIGHT_MAX) << 40;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Unpacks a quad back into its rectangle and hashes every unit face in it. Sprite quads are one block.
+uint64_t QuadFaceHash(const Quad *quad, int sx, int sy, int sz) {
+    int lo[3] = { 31, 31, 31 }, hi[3] = { 0, 0, 0 };
+    for (int corner = 0; corner < 4; corner++) {
+        uint32_t vertex = quad->vertices[corner];
+        int p[3] = { vertex & 31, vertex >> 5 & 31, vertex >> 10 & 31 };
+        for (int axis = 0; axis < 3; axis++) {
+            lo[axis] = p[axis] < lo[axis] ? p[axis] : lo[axis];
+            hi[axis] = p[axis] > hi[axis] ? p[axis] : hi[axis];
+        }
+    }
+
+    int face = quad->vertices[0] >> 15 & 7;
+    int tile = quad->vertices[0] >> 20 & 0xFF;
+    int light = quad->vertices[0] >> 28;
+
+    // Block faces are flat along their axis and sit on the far side for positive faces
+    int axis = face < 6 ? 2 - face / 2 : -1;
+    if (axis >= 0) {
+        if (face % 2 == 0) lo[axis]--;
+        hi[axis] = lo[axis] + 1;
+    }
+
+    uint64_t hash = 0;
+    for (int z = lo[2]; z < hi[2]; z++) {
+        for (int y = lo[1]; y < hi[1]; y++) {
+            for (int x = lo[0]; x < hi[0]; x++) {
+                hash += FaceHash(face, sx * SECTION_SIZE + x, sy * SECTION_SIZE + y, sz * SECTION_SIZE + z, tile, light);
+            }
+        }
+    }
+    return hash;
+}
+
+void MeshWorld(ChunkMap *map, WorldResult *result) {
+    GreedyMesher *mesher = (GreedyMesher*)malloc(sizeof(GreedyMesher));
+    SectionSnapshot *snapshot = (SectionSnapshot*)malloc(sizeof(SectionSnapshot));
+    MeshArena arena = newMeshArena(MAX_SECTION_QUADS + MAX_SECTION_SPRITE_QUADS);
+
+    // Section coordinates of every loaded chunk, gathered once so the timing covers meshing only
+    int *sections = (int*)malloc(map->count * SECTION_COUNT * 3 * sizeof(int));
+    int count = 0;
+    for (int i = 0; i < map->capacity; i++) {
+        Chunk *chunk = map->slots[i].chunk;
+        if (chunk == NULL) continue;
+
+        for (int s = 0; s < SECTION_COUNT; s++) {
+            sections[count * 3 + 0] = chunk->cx * SECTIONS_PER_AXIS + s % SECTIONS_PER_AXIS;
+            sections[count * 3 + 1] = chunk->cy * SECTIONS_PER_AXIS + s / SECTIONS_PER_AXIS % SECTIONS_PER_AXIS;
+            sections[count * 3 + 2] = chunk->cz * SECTIONS_PER_AXIS + s / (SECTIONS_PER_AXIS * SECTIONS_PER_AXIS);
+            count++;
+        }
+    }
+
+    result->chunks = map->count;
+    result->sections = count;
+    result->bestTime = INFINITY;
+
+    for (int round = 0; round < MESH_ROUNDS; round++) {
+        bool last = round == MESH_ROUNDS - 1;
+        result->faces = result->quads = result->spriteQuads = result->bytesAllocated = 0;
+        result->faceHash = 0;
+
+        double start = Now();
+        double hashTime = 0;
+        for (int i = 0; i < count; i++) {
+            int sx = sections[i * 3 + 0], sy = sections[i * 3 + 1], sz = sections[i * 3 + 2];
+
+            TakeSectionSnapshot(snapshot, map, sx, sy, sz);
+            resetMeshArena(&arena);
+            SectionMeshInfo info = CountSectionMesh(mesher, snapshot);
+            info.quads = EmitSectionMesh(mesher, snapshot, &arena);
+
+            int totalQuads = (int)arena.count;
+            Quad *quads = NULL;
+            if (totalQuads > 0) {
+                quads = (Quad*)malloc(totalQuads * sizeof(Quad));
+                memcpy(quads, arena.quads, totalQuads * sizeof(Quad));
+            }
+
+            result->faces += info.faces;
+            result->quads += info.quads;
+            result->spriteQuads += info.spriteQuads;
+            result->bytesAllocated += totalQuads * sizeof(Quad);
+
+            // Hashing runs once and stays out of the timing
+            if (last) {
+                double hashStart = Now();
+                for (int q = 0; q < totalQuads; q++) {
+                    result->faceHash += QuadFaceHash(&quads[q], sx, sy, sz);
+                }
+                hashTime += Now() - hashStart;
+            }
+            free(quads);
+        }
+        result->bestTime = fmin(result->bestTime, Now() - start - hashTime);
+    }
+
+    free(sections);
+    freeMeshArena(&arena);
+    free(snapshot);
+    free(mesher);
+}
+
+void FreeWorld(ChunkMap *map) {
+    for (int i = 0; i < map->capacity; i++) {
+        if (map->slots[i].chunk != NULL) FreeChunk(map->slots[i].chunk);
+    }
+    free(map->slots);
+}
+
+void PrintResults(const WorldResult *results, int count) {
+    printf("{\n");
+    printf("  \"rounds\": %d,\n", MESH_ROUNDS);
+    printf("  \"worlds\": [\n");
+    for (int i = 0; i < count; i++) {
+        const WorldResult *r = &results[i];
+        printf("    {\n");
+        printf("      \"name\": \"%s\",\n", r->name);
+        printf("      \"chunks\": %d,\n", r->chunks);
+        printf("      \"sections\": %d,\n", r->sections);
+        printf("      \"msPerRemesh\": %.4f,\n", r->bestTime * 1000 / r->sections);
+        printf("      \"msTotal\": %.3f,\n", r->bestTime * 1000);
+        printf("      \"faces\": %ld,\n", r->faces);
+        printf("      \"quads\": %ld,\n", r->quads);
+        printf("      \"spriteQuads\": %ld,\n", r->spriteQuads);
+        printf("      \"bytesAllocated\": %ld,\n", r->bytesAllocated);
+        printf("      \"faceHash\": \"%016llx\"\n", (unsigned long long)r->faceHash);
+        printf("    }%s\n", i + 1 < count ? "," : "");
+    }
+    printf("  ]\n");
+    printf("}\n");
+}
+
+// Compares faces and faceHash with a file written by an earlier run. Worlds missing from either side are skipped.
+bool CheckResults(const WorldResult *results, int count, const char *baselineName) {
+    FILE *file = fopen(baselineName, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Cannot open %s\n", baselineName);
+        return false;
+    }
+
+    char text[1 << 14];
+    size_t size = fread(text, 1, sizeof(text) - 1, file);
+    text[size] = '\0';
+    fclose(file);
+
+    bool same = true;
+    for (int i = 0; i < count; i++) {
+        char key[64];
+        snprintf(key, sizeof(key), "\"name\": \"%s\"", results[i].name);
+        const char *world = strstr(text, key);
+        if (world == NULL) continue;
+
+        long faces = -1;
+        unsigned long long hash = 0;
+        const char *field = strstr(world, "\"faces\":");
+        if (field != NULL) sscanf(field, "\"faces\": %ld", &faces);
+        field = strstr(world, "\"faceHash\":");
+        if (field != NULL) sscanf(field, "\"faceHash\": \"%llx\"", &hash);
+
+        if (faces != results[i].faces || hash != results[i].faceHash) {
+            fprintf(stderr, "%s: meshes differ from %s (faces %ld vs %ld, faceHash %016llx vs %016llx)\n",
+                results[i].name, baselineName, results[i].faces, faces, (unsigned long long)results[i].faceHash, hash);
+            same = false;
+        }
+    }
+    return same;
+}
+
+int main(int argc, char **argv) {
+    const char *savedDirectory = "../bin";
+    const char *baselineName = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--saved") == 0 && i + 1 < argc) savedDirectory = argv[++i];
+        else if (strcmp(argv[i], "--check") == 0 && i + 1 < argc) baselineName = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--saved directory] [--check baseline.json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    CpuInit();
+    Crc32cInit();
+
+    WorldResult results[MAX_WORLDS];
+    int count = 0;
+    LightEngine engine = { 0 };
+
+    for (int world = 0; world < MAX_WORLDS; world++) {
+        ChunkMap map;
+        ChunkMapInit(&map, 64);
+
+        WorldResult *result = &results[count];
+        memset(result, 0, sizeof(WorldResult));
+        bool built = true;
+
+        switch (world) {
+            case 0: result->name = "flat"; BuildFlatWorld(&map); break;
+            case 1: result->name = "noise"; BuildNoiseWorld(&map); break;
+            case 2: result->name = "checkerboard"; BuildCheckerboardWorld(&map); break;
+            case 3: result->name = "saved"; built = BuildSavedWorld(&map, savedDirectory); break;
+        }
+
+        if (built) {
+            LightWorld(&map, &engine);
+            MeshWorld(&map, result);
+            count++;
+        } else {
+            fprintf(stderr, "No saved world in %s, skipping it\n", savedDirectory);
+        }
+        FreeWorld(&map);
+    }
+
+    LightEngineFree(&engine);
+    PrintResults(results, count);
+
+    if (baselineName != NULL && !CheckResults(results, count, baselineName)) return 1;
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,241 @@
+// Ray cast throughput. Casts the same set of visibility checks, segments between random points of
+// the loaded chunks, one at a time through DDACast and in batches through DDACastBatch, and prints
+// rays per second for both as JSON. Needs no window or GPU, only the headers:
+//
+//   cc -O2 -I.. -I../raylib/include raycast.c -o raycast -lm
+//   ./raycast
+//
+// batch says which path DDACastBatch took on this CPU. Without AVX2 it falls back to DDACast and
+// both columns should read the same.
+// Worlds: the flat world LoadWorld generates around spawn, sparse noise that rays cross far into,
+// and the saved world around spawn from the directory given with --saved (default ../bin).
+//
+// mismatches counts rays where the batch hit a different block or face than DDACast. Both step the
+// same integer rays, so it should always be 0.
+
+#include <time.h>
+#include <math.h>
+
+#include "raylib.h"
+#define RAYMATH_STATIC_INLINE
+#include "raymath.h"
+
+#include "cpu.h"
+#include "arena.h"
+#include "sprites.h"
+#include "palette.h"
+#include "world.h"
+#include "codec.h"
+#include "mapfile.h"
+#include "crc32c.h"
+#include "region.h"
+
+#define PROFILE_ZONE(name)
+#include "dda.h"
+
+#define RAY_COUNT 100000
+#define RAY_ROUNDS 8
+#define MAX_WORLDS 3
+
+typedef struct {
+    const char *name;
+    int chunks;
+    double scalarTime;  // Seconds for every ray, best of RAY_ROUNDS
+    double batchTime;
+    long hits;
+    long steps;
+    long mismatches;
+} WorldResult;
+
+double Now() {
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// The chunks LoadWorld brings in around the spawn point, LOAD_RADIUS 1
+void BuildFlatWorld(ChunkMap *map) {
+    for (int cz = -1; cz <= 1; cz++) {
+        for (int cy = -1; cy <= 1; cy++) {
+            for (int cx = -1; cx <= 1; cx++) {
+                Chunk *chunk = NewChunk(map, cx, cy, cz);
+                GenerateChunk(chunk);
+                RebuildChunkOccupancy(chunk);
+                ChunkMapInsert(map, chunk);
+            }
+        }
+    }
+}
+
+// The same 3x3x3 chunks with one block in 500 solid, so most rays cross open air for a while
+void BuildSparseWorld(ChunkMap *map) {
+    srand(1);
+    for (int cz = -1; cz <= 1; cz++) {
+        for (int cy = -1; cy <= 1; cy++) {
+            for (int cx = -1; cx <= 1; cx++) {
+                Chunk *chunk = NewChunk(map, cx, cy, cz);
+                PackedBlocksInit(&chunk->blocks, CHUNK_VOLUME, 0);
+                for (int i = 0; i < CHUNK_VOLUME; i++) {
+                    if (rand() % 500 == 0) PackedBlocksSet(&chunk->blocks, i, 1 + rand() % 4);
+                }
+                RebuildChunkOccupancy(chunk);
+                ChunkMapInsert(map, chunk);
+            }
+        }
+    }
+}
+
+// The saved chunks around spawn, the others generated like LoadChunk does. False when nothing was saved.
+bool BuildSavedWorld(ChunkMap *map, const char *directory) {
+    char previous[4096];
+    if (getcwd(previous, sizeof(previous)) == NULL || chdir(directory) != 0) return false;
+
+    int saved = 0;
+    for (int cz = -1; cz <= 1; cz++) {
+        for (int cy = -1; cy <= 1; cy++) {
+            for (int cx = -1; cx <= 1; cx++) {
+                Chunk *chunk = NewChunk(map, cx, cy, cz);
+                if (LoadChunkFile(chunk, true)) saved++;
+                else GenerateChunk(chunk);
+                RebuildChunkOccupancy(chunk);
+                ChunkMapInsert(map, chunk);
+            }
+        }
+    }
+    UnmapAllRegions();
+
+    chdir(previous);
+    return saved > 0;
+}
+
+static float RandomCoordinate() {
+    return -CHUNK_SIZE + rand() / (float)RAND_MAX * 3 * CHUNK_SIZE;
+}
+
+// Segments between random points of the 3x3x3 chunks, the same for every world
+void MakeRays(Vector3 *origins, Vector3 *directions, float *maxDistances) {
+    srand(2);
+    for (int i = 0; i < RAY_COUNT; i++) {
+        Vector3 from = { RandomCoordinate(), RandomCoordinate(), RandomCoordinate() };
+        Vector3 to = { RandomCoordinate(), RandomCoordinate(), RandomCoordinate() };
+        origins[i] = from;
+        directions[i] = Vector3Subtract(to, from);
+        maxDistances[i] = Vector3Length(directions[i]);
+    }
+}
+
+void CastWorld(ChunkMap *map, const Vector3 *origins, const Vector3 *directions, const float *maxDistances, WorldResult *result) {
+    DDAHit *scalar = (DDAHit*)malloc(RAY_COUNT * sizeof(DDAHit));
+    DDAHit *batch = (DDAHit*)malloc(RAY_COUNT * sizeof(DDAHit));
+
+    result->chunks = map->count;
+    result->scalarTime = result->batchTime = INFINITY;
+
+    for (int round = 0; round < RAY_ROUNDS; round++) {
+        double start = Now();
+        for (int i = 0; i < RAY_COUNT; i++) {
+            scalar[i] = DDACast(map, origins[i], directions[i], maxDistances[i]);
+        }
+        result->scalarTime = fmin(result->scalarTime, Now() - start);
+
+        start = Now();
+        DDACastBatch(map, origins, directions, maxDistances, RAY_COUNT, batch);
+        result->batchTime = fmin(result->batchTime, Now() - start);
+    }
+
+    result->hits = result->steps = result->mismatches = 0;
+    for (int i = 0; i < RAY_COUNT; i++) {
+        const DDAHit *a = &scalar[i], *b = &batch[i];
+        result->hits += b->hit;
+        result->steps += b->steps;
+        if (a->hit != b->hit || (a->hit && (a->x != b->x || a->y != b->y || a->z != b->z || !Vector3Equals(a->normal, b->normal)))) {
+            result->mismatches++;
+        }
+    }
+
+    free(scalar);
+    free(batch);
+}
+
+void FreeWorld(ChunkMap *map) {
+    for (int i = 0; i < map->capacity; i++) {
+        if (map->slots[i].chunk != NULL) FreeChunk(map->slots[i].chunk);
+    }
+    free(map->slots);
+}
+
+void PrintResults(const WorldResult *results, int count) {
+    printf("{\n");
+    printf("  \"rays\": %d,\n", RAY_COUNT);
+    printf("  \"rounds\": %d,\n", RAY_ROUNDS);
+    printf("  \"batch\": \"%s\",\n", cpu.avx2 ? "avx2" : "scalar");
+    printf("  \"worlds\": [\n");
+    for (int i = 0; i < count; i++) {
+        const WorldResult *r = &results[i];
+        printf("    {\n");
+        printf("      \"name\": \"%s\",\n", r->name);
+        printf("      \"chunks\": %d,\n", r->chunks);
+        printf("      \"scalarRaysPerSecond\": %.0f,\n", RAY_COUNT / r->scalarTime);
+        printf("      \"batchRaysPerSecond\": %.0f,\n", RAY_COUNT / r->batchTime);
+        printf("      \"speedup\": %.2f,\n", r->scalarTime / r->batchTime);
+        printf("      \"hits\": %ld,\n", r->hits);
+        printf("      \"stepsPerRay\": %.2f,\n", (double)r->steps / RAY_COUNT);
+        printf("      \"mismatches\": %ld\n", r->mismatches);
+        printf("    }%s\n", i + 1 < count ? "," : "");
+    }
+    printf("  ]\n");
+    printf("}\n");
+}
+
+int main(int argc, char **argv) {
+    const char *savedDirectory = "../bin";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--saved") == 0 && i + 1 < argc) savedDirectory = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--saved directory]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    CpuInit();
+    Crc32cInit();
+
+    Vector3 *origins = (Vector3*)malloc(RAY_COUNT * sizeof(Vector3));
+    Vector3 *directions = (Vector3*)malloc(RAY_COUNT * sizeof(Vector3));
+    float *maxDistances = (float*)malloc(RAY_COUNT * sizeof(float));
+    MakeRays(origins, directions, maxDistances);
+
+    WorldResult results[MAX_WORLDS];
+    int count = 0;
+
+    for (int world = 0; world < MAX_WORLDS; world++) {
+        ChunkMap map;
+        ChunkMapInit(&map, 64);
+
+        WorldResult *result = &results[count];
+        memset(result, 0, sizeof(WorldResult));
+        bool built = true;
+
+        switch (world) {
+            case 0: result->name = "flat"; BuildFlatWorld(&map); break;
+            case 1: result->name = "sparse"; BuildSparseWorld(&map); break;
+            case 2: result->name = "saved"; built = BuildSavedWorld(&map, savedDirectory); break;
+        }
+
+        if (built) {
+            CastWorld(&map, origins, directions, maxDistances, result);
+            count++;
+        } else {
+            fprintf(stderr, "No saved world in %s, skipping it\n", savedDirectory);
+        }
+        FreeWorld(&map);
+    }
+
+    PrintResults(results, count);
+
+    free(origins);
+    free(directions);
+    free(maxDistances);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+// Headless player simulation. Replays a scripted walk over the flat world LoadWorld generates,
+// first tick by tick as fast as it runs, then through FixedTimestep at several frame rates the way
+// the game loop drives it, and prints the results as JSON:
+//
+//   cc -O2 -I.. -I../raylib/include simulate.c -o simulate -lm
+//   ./simulate
+//
+// Every frame rate has to end on exactly the same position as the straight run, otherwise physics
+// depends on frame timing and the run exits with 1.
+
+#include <time.h>
+#include <math.h>
+
+#include "raylib.h"
+#define RAYMATH_STATIC_INLINE
+#include "raymath.h"
+
+#include "arena.h"
+#include "sprites.h"
+#include "palette.h"
+#include "world.h"
+#include "collision.h"
+#include "player.h"
+#include "timestep.h"
+
+#define SIMULATED_SECONDS 600
+
+double Now() {
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// The chunks LoadWorld brings in around the spawn point, LOAD_RADIUS 1
+void BuildFlatWorld(ChunkMap *map) {
+    for (int cz = -1; cz <= 1; cz++) {
+        for (int cy = -1; cy <= 1; cy++) {
+            for (int cx = -1; cx <= 1; cx++) {
+                Chunk *chunk = NewChunk(map, cx, cy, cz);
+                GenerateChunk(chunk);
+                ChunkMapInsert(map, chunk);
+            }
+        }
+    }
+}
+
+// Input for a tick: walks in a direction that turns every few seconds, jumping now and then, and
+// stays near spawn so the player does not walk off the loaded chunks
+PlayerInput ScriptedInput(uint64_t tick, Vector3 position) {
+    PlayerInput input = { 0 };
+    uint64_t phase = tick / (3 * SIMULATION_HZ);
+
+    input.forward = phase % 4 == 3 ? 0.0f : 1.0f;
+    input.right = phase % 3 == 1 ? 1.0f : 0.0f;
+    input.yaw = (float)(phase * 2.3999632);  // Golden angle, so headings do not repeat
+    if (Vector3Length((Vector3){ position.x, 0, position.z }) > 40) input.yaw = atan2f(-position.z, -position.x);
+    input.jump = tick % 97 == 0;
+    return input;
+}
+
+Player StartPlayer() {
+    Player player = { 0 };
+    player.position = (Vector3){ 16, 10.0f, CHUNK_SIZE / 2.0f };
+    return player;
+}
+
+// Drives the simulation through FixedTimestep with frames of frameTime seconds, jittered by up to
+// jitter of that, until it has run ticks ticks
+Player RunFrames(const ChunkMap *map, uint64_t ticks, double frameTime, double jitter) {
+    Player player = StartPlayer();
+    FixedTimestep clock;
+    FixedTimestepInit(&clock, SIMULATION_HZ);
+    srand(1);
+
+    while (clock.ticks < ticks) {
+        double frame = frameTime * (1 + jitter * (rand() / (double)RAND_MAX * 2 - 1));
+        uint64_t first = clock.ticks;
+        int steps = FixedTimestepAdvance(&clock, frame);
+        for (int i = 0; i < steps && first + i < ticks; i++) {
+            SimulatePlayer(&player, map, ScriptedInput(first + i, player.position), (float)clock.step);
+        }
+    }
+    return player;
+}
+
+int main() {
+    ChunkMap map;
+    ChunkMapInit(&map, 64);
+    BuildFlatWorld(&map);
+
+    FixedTimestep clock;
+    FixedTimestepInit(&clock, SIMULATION_HZ);
+    uint64_t ticks = (uint64_t)SIMULATED_SECONDS * SIMULATION_HZ;
+
+    Player reference = StartPlayer();
+    double start = Now();
+    for (uint64_t tick = 0; tick < ticks; tick++) {
+        SimulatePlayer(&reference, &map, ScriptedInput(tick, reference.position), (float)clock.step);
+    }
+    double elapsed = Now() - start;
+
+    const double rates[] = { 30, 60, 144, 240 };
+    bool same = true;
+
+    printf("{\n");
+    printf("  \"rate\": %d,\n", SIMULATION_HZ);
+    printf("  \"ticks\": %llu,\n", (unsigned long long)ticks);
+    printf("  \"ticksPerSecond\": %.0f,\n", ticks / elapsed);
+    printf("  \"timesRealTime\": %.0f,\n", SIMULATED_SECONDS / elapsed);
+    printf("  \"position\": [%.6f, %.6f, %.6f],\n", reference.position.x, reference.position.y, reference.position.z);
+    printf("  \"frameRates\": [\n");
+    for (int i = 0; i < 4; i++) {
+        Player player = RunFrames(&map, ticks, 1.0 / rates[i], 0.5);
+        bool match = memcmp(&player.position, &reference.position, sizeof(Vector3)) == 0;
+        same = same && match;
+        printf("    { \"fps\": %.0f, \"matches\": %s }%s\n", rates[i], match ? "true" : "false", i < 3 ? "," : "");
+    }
+    printf("  ]\n");
+    printf("}\n");
+
+    return same ? 0 : 1;
+}
\ No newline at end of file
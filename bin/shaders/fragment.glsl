@@ -2,20 +2,27 @@
 
 // Input vertex attributes (from vertex shader)
 in vec2 fragTexCoord;
+in vec2 fragTile;
 in vec3 fragPosition;
 in vec3 fragNormal;
+in float fragLight;
 
 // Input uniform values
 uniform sampler2D texture0;
 uniform vec3 viewPos;
+uniform float atlasTiles;
 
 // Output fragment color
 out vec4 finalColor;
 
 void main()
 {
-    // Texture sampling
-    vec4 texelColor = texture(texture0, fragTexCoord);
+    // Texture sampling, merged quads repeat the atlas tile once per block
+    vec2 atlasCoord = (fragTile + fract(fragTexCoord)) / atlasTiles;
+    vec4 texelColor = texture(texture0, atlasCoord);
+
+    // Cut out the transparent parts of sprites
+    if (texelColor.a < 0.1) discard;
 
     // Ambient lighting
     float ambientStrength = 0.7;
@@ -26,8 +33,11 @@ void main()
     float diff = abs(dot(fragNormal, lightDir));
     vec3 diffuse = diff * vec3(0.5);
 
+    // Baked flood fill light level, 0 to 15, each level 20% dimmer than the one above
+    float brightness = mix(0.04, 1.0, pow(0.8, 15.0 - fragLight));
+
     // Combine results
-    vec3 result = (ambient + diffuse) * texelColor.rgb;
+    vec3 result = (ambient + diffuse) * brightness * texelColor.rgb;
 
     // Apply fog
     float fogStart = 10.0;
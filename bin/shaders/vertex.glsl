@@ -1,30 +1,62 @@
 #version 330
 
-// Input vertex attributes
-in vec3 vertexPosition;
-in vec2 vertexTexCoord;
-in vec3 vertexNormal;
+// Input vertex attributes: one packed 32-bit word per vertex, read as four unsigned bytes
+// bits 0-14 section-local position, 15-17 face, 18-19 corner, 20-27 atlas tile, 28-31 light
+layout(location = 0) in vec4 vertexData;
 
 // Input uniform values
 uniform mat4 mvp;
-uniform mat4 matModel;
+uniform vec3 sectionOrigin;
+uniform float atlasTiles;
 
 // Output vertex attributes (to fragment shader)
 out vec2 fragTexCoord;
+out vec2 fragTile;
 out vec3 fragPosition;
 out vec3 fragNormal;
+out float fragLight;
+
+// Face order: +Z, -Z, +Y, -Y, +X, -X, then the two diagonal planes of crossed sprites
+const vec3 faceNormals[8] = vec3[8](
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0),
+    vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0),
+    vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+    vec3(0.7071, 0.0, -0.7071), vec3(0.7071, 0.0, 0.7071)
+);
+
+// Texture axes of each face in block units, the fragment shader wraps them per block
+const vec3 faceTexU[8] = vec3[8](
+    vec3(-1.0, 0.0, 0.0), vec3(1.0, 0.0, 0.0),
+    vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0),
+    vec3(1.0, 0.0, 0.0), vec3(0.0, 0.0, 1.0)
+);
+const vec3 faceTexV[8] = vec3[8](
+    vec3(0.0, -1.0, 0.0), vec3(0.0, -1.0, 0.0),
+    vec3(0.0, 0.0, -1.0), vec3(0.0, 0.0, -1.0),
+    vec3(0.0, -1.0, 0.0), vec3(0.0, -1.0, 0.0),
+    vec3(0.0, -1.0, 0.0), vec3(0.0, -1.0, 0.0)
+);
 
 void main()
 {
-    // Calculate fragment position in world space
-    fragPosition = vec3(matModel * vec4(vertexPosition, 1.0));
+    uvec4 bytes = uvec4(vertexData);
+    uint data = bytes.x | (bytes.y << 8) | (bytes.z << 16) | (bytes.w << 24);
 
-    // Calculate fragment normal in world space
-    fragNormal = normalize(mat3(matModel) * vertexNormal);
+    vec3 localPosition = vec3(data & 31u, (data >> 5) & 31u, (data >> 10) & 31u);
+    int face = int((data >> 15) & 7u);
+    float tile = float((data >> 20) & 255u);
+    float light = float(data >> 28);
+
+    // Calculate fragment position in world space
+    fragPosition = sectionOrigin + localPosition;
+    fragNormal = faceNormals[face];
+    fragLight = light;
 
     // Send vertex attributes to fragment shader
-    fragTexCoord = vertexTexCoord;
+    fragTexCoord = vec2(dot(faceTexU[face], localPosition), dot(faceTexV[face], localPosition));
+    fragTile = vec2(mod(tile, atlasTiles), floor(tile / atlasTiles));
 
     // Calculate final vertex position
-    gl_Position = mvp * vec4(vertexPosition, 1.0);
-}
+    gl_Position = mvp * vec4(fragPosition, 1.0);
+}
\ No newline at end of file
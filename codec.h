@@ -0,0 +1,274 @@
+// Self-contained compression for saved chunks. Blocks are written as their palette followed by
+// runs of equal palette indices, then the whole thing goes through a small LZ77 pass that folds
+// the runs repeated from one section row or layer to the next.
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    size_t pos;
+    bool failed;  // Set once a read runs past the end or finds a malformed value
+} ByteReader;
+
+void ByteBufferReserve(ByteBuffer *buffer, size_t extra) {
+    if (buffer->size + extra <= buffer->capacity) return;
+
+    size_t capacity = buffer->capacity ? buffer->capacity : 256;
+    while (capacity < buffer->size + extra) capacity *= 2;
+    buffer->data = (unsigned char*)realloc(buffer->data, capacity);
+    buffer->capacity = capacity;
+}
+
+void ByteBufferPush(ByteBuffer *buffer, const void *data, size_t size) {
+    ByteBufferReserve(buffer, size);
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+}
+
+void ByteBufferPushByte(ByteBuffer *buffer, unsigned char byte) {
+    ByteBufferPush(buffer, &byte, 1);
+}
+
+// Seven bits per byte, high bit set on all but the last
+void ByteBufferPushVarint(ByteBuffer *buffer, uint32_t value) {
+    while (value >= 0x80) {
+        ByteBufferPushByte(buffer, (unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    ByteBufferPushByte(buffer, (unsigned char)value);
+}
+
+void ByteBufferFree(ByteBuffer *buffer) {
+    free(buffer->data);
+    *buffer = (ByteBuffer){ 0 };
+}
+
+ByteReader ByteReaderCreate(const unsigned char *data, size_t size) {
+    return (ByteReader){ data, size, 0, false };
+}
+
+uint32_t ByteReaderVarint(ByteReader *reader) {
+    uint32_t value = 0;
+
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (reader->pos >= reader->size) break;
+
+        unsigned char byte = reader->data[reader->pos++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+
+    reader->failed = true;
+    return 0;
+}
+
+// Block ids can be negative, zigzag keeps small magnitudes in one byte
+static inline uint32_t ZigZag(int value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int UnZigZag(uint32_t value) {
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+// LZ77 in sequences of: token (literal count << 4 | match length - 4), literals, 16-bit offset.
+// A nibble of 15 continues in extra bytes that add up until one is below 255.
+// The last sequence holds only literals.
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 14
+
+static inline uint32_t LzHash(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static void LzPushLength(ByteBuffer *out, size_t length) {
+    while (length >= 255) {
+        ByteBufferPushByte(out, 255);
+        length -= 255;
+    }
+    ByteBufferPushByte(out, (unsigned char)length);
+}
+
+static void LzPushSequence(ByteBuffer *out, const unsigned char *literals, size_t literalCount, size_t offset, size_t matchLength) {
+    size_t matchCode = matchLength ? matchLength - LZ_MIN_MATCH : 0;
+    unsigned char token = (unsigned char)((literalCount < 15 ? literalCount : 15) << 4 | (matchCode < 15 ? matchCode : 15));
+
+    ByteBufferPushByte(out, token);
+    if (literalCount >= 15) LzPushLength(out, literalCount - 15);
+    ByteBufferPush(out, literals, literalCount);
+
+    if (matchLength == 0) return;
+    ByteBufferPushByte(out, (unsigned char)offset);
+    ByteBufferPushByte(out, (unsigned char)(offset >> 8));
+    if (matchCode >= 15) LzPushLength(out, matchCode - 15);
+}
+
+void LzCompress(const unsigned char *in, size_t size, ByteBuffer *out) {
+    // Positions are stored plus one, so zero means empty
+    uint32_t *table = (uint32_t*)calloc(1 << LZ_HASH_BITS, sizeof(uint32_t));
+    size_t anchor = 0;
+    size_t i = 0;
+
+    while (i + LZ_MIN_MATCH <= size) {
+        uint32_t h = LzHash(in + i);
+        size_t candidate = table[h];
+        table[h] = (uint32_t)(i + 1);
+
+        if (candidate == 0 || i - (candidate - 1) > LZ_MAX_OFFSET || memcmp(in + candidate - 1, in + i, LZ_MIN_MATCH) != 0) {
+            i++;
+            continue;
+        }
+
+        size_t match = candidate - 1;
+        size_t length = LZ_MIN_MATCH;
+        while (i + length < size && in[match + length] == in[i + length]) length++;
+
+        LzPushSequence(out, in + anchor, i - anchor, i - match, length);
+        i += length;
+        anchor = i;
+    }
+
+    LzPushSequence(out, in + anchor, size - anchor, 0, 0);
+    free(table);
+}
+
+static bool LzReadLength(ByteReader *reader, size_t *length) {
+    unsigned char byte;
+    do {
+        if (reader->pos >= reader->size) return false;
+        byte = reader->data[reader->pos++];
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// Decompresses into out, which must be exactly outSize bytes once done. Returns false on malformed input.
+bool LzDecompress(const unsigned char *in, size_t size, unsigned char *out, size_t outSize) {
+    ByteReader reader = ByteReaderCreate(in, size);
+    size_t written = 0;
+
+    while (reader.pos < reader.size) {
+        unsigned char token = reader.data[reader.pos++];
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !LzReadLength(&reader, &literalCount)) return false;
+        if (literalCount > reader.size - reader.pos || literalCount > outSize - written) return false;
+
+        memcpy(out + written, reader.data + reader.pos, literalCount);
+        reader.pos += literalCount;
+        written += literalCount;
+
+        if (reader.pos == reader.size) break;
+
+        if (reader.size - reader.pos < 2) return false;
+        size_t offset = reader.data[reader.pos] | reader.data[reader.pos + 1] << 8;
+        reader.pos += 2;
+
+        size_t length = token & 15;
+        if (length == 15 && !LzReadLength(&reader, &length)) return false;
+        length += LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > written || length > outSize - written) return false;
+
+        // Byte by byte, matches may overlap the bytes they produce
+        for (size_t k = 0; k < length; k++) {
+            out[written + k] = out[written - offset + k];
+        }
+        written += length;
+    }
+
+    return written == outSize;
+}
+
+// Appends a compressed copy of the blocks: varint raw size, then the LZ stream of
+// palette count, zigzagged palette ids and (palette index, run length - 1) pairs
+void EncodeBlocks(const PackedBlocks *blocks, ByteBuffer *out) {
+    ByteBuffer raw = { 0 };
+
+    ByteBufferPushVarint(&raw, blocks->paletteCount);
+    for (int i = 0; i < blocks->paletteCount; i++) {
+        ByteBufferPushVarint(&raw, ZigZag(blocks->palette[i]));
+    }
+
+    int entry = PackedEntry(blocks, 0);
+    int run = 0;
+    for (int i = 0; i < blocks->volume; i++) {
+        int next = PackedEntry(blocks, i);
+        if (next != entry) {
+            ByteBufferPushVarint(&raw, entry);
+            ByteBufferPushVarint(&raw, run - 1);
+            entry = next;
+            run = 0;
+        }
+        run++;
+    }
+    ByteBufferPushVarint(&raw, entry);
+    ByteBufferPushVarint(&raw, run - 1);
+
+    ByteBufferPushVarint(out, (uint32_t)raw.size);
+    LzCompress(raw.data, raw.size, out);
+    ByteBufferFree(&raw);
+}
+
+// Rebuilds blocks written by EncodeBlocks. Returns false, leaving blocks untouched, on malformed data.
+bool DecodeBlocks(const unsigned char *data, size_t size, PackedBlocks *blocks, int volume) {
+    ByteReader reader = ByteReaderCreate(data, size);
+    uint32_t rawSize = ByteReaderVarint(&reader);
+
+    // Every run takes at least two bytes and covers at least one block, bounding a sane size
+    size_t maxRawSize = 5 + 5 * ((size_t)1 << PACKED_MAX_BITS) + 10 * (size_t)volume;
+    if (reader.failed || rawSize == 0 || rawSize > maxRawSize) return false;
+
+    unsigned char *raw = (unsigned char*)malloc(rawSize);
+    if (!LzDecompress(data + reader.pos, size - reader.pos, raw, rawSize)) {
+        free(raw);
+        return false;
+    }
+
+    reader = ByteReaderCreate(raw, rawSize);
+    uint32_t paletteCount = ByteReaderVarint(&reader);
+    if (reader.failed || paletteCount == 0 || paletteCount > (1u << PACKED_MAX_BITS)) {
+        free(raw);
+        return false;
+    }
+
+    int *palette = (int*)malloc(paletteCount * sizeof(int));
+    for (uint32_t i = 0; i < paletteCount; i++) {
+        palette[i] = UnZigZag(ByteReaderVarint(&reader));
+    }
+
+    PackedBlocks decoded;
+    PackedBlocksInitPalette(&decoded, volume, palette, paletteCount);
+    free(palette);
+
+    int index = 0;
+    while (!reader.failed && reader.pos < reader.size) {
+        uint32_t entry = ByteReaderVarint(&reader);
+        uint32_t run = ByteReaderVarint(&reader) + 1;
+        if (entry >= paletteCount || run > (uint32_t)(volume - index)) {
+            reader.failed = true;
+            break;
+        }
+
+        for (uint32_t k = 0; k < run; k++) {
+            PackedSetEntry(&decoded, index++, entry);
+        }
+    }
+    free(raw);
+
+    if (reader.failed || index != volume) {
+        PackedBlocksFree(&decoded);
+        return false;
+    }
+
+    *blocks = decoded;
+    return true;
+}
\ No newline at end of file
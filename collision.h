@@ -0,0 +1,94 @@
+// Swept collision of axis aligned boxes against the block grid. A move is resolved one axis at a
+// time: the box's leading face is pushed through the layers of cells in front of it, and the first
+// layer holding a solid block stops it. Every layer between the start and the end of the move is
+// tested, so nothing is skipped however large the move is.
+//
+// Faces closer than COLLISION_SKIN count as touching, not overlapping. A box resting exactly
+// against a block can then slide along it, and one rounded a hair into it is pushed back out.
+
+#define COLLISION_SKIN 1e-4f
+
+// Air and sprites can be walked through
+static inline bool BlockSolid(int id) {
+    return id > 0;
+}
+
+static inline float BoxAxisMin(BoundingBox box, int axis) {
+    return axis == 0 ? box.min.x : axis == 1 ? box.min.y : box.min.z;
+}
+
+static inline float BoxAxisMax(BoundingBox box, int axis) {
+    return axis == 0 ? box.max.x : axis == 1 ? box.max.y : box.max.z;
+}
+
+// Cells the box overlaps on an axis, touching faces excluded
+static inline void BoxCellRange(BoundingBox box, int axis, int *first, int *last) {
+    *first = (int)floorf(BoxAxisMin(box, axis) + COLLISION_SKIN);
+    *last = (int)ceilf(BoxAxisMax(box, axis) - COLLISION_SKIN) - 1;
+}
+
+// True when a solid block lies in layer of axis, within the given cell ranges of the other two
+static bool SolidInLayer(const ChunkMap *map, int axis, int layer, const int first[3], const int last[3]) {
+    int a = (axis + 1) % 3, b = (axis + 2) % 3;
+    int cell[3];
+    cell[axis] = layer;
+
+    for (cell[b] = first[b]; cell[b] <= last[b]; cell[b]++) {
+        for (cell[a] = first[a]; cell[a] <= last[a]; cell[a]++) {
+            if (BlockSolid(GetBlock(map, cell[0], cell[1], cell[2]))) return true;
+        }
+    }
+    return false;
+}
+
+// How far box can move along axis, up to delta, before it touches a solid block
+float SweepBoxAxis(const ChunkMap *map, BoundingBox box, int axis, float delta) {
+    if (delta == 0) return 0;
+
+    int first[3], last[3];
+    for (int i = 0; i < 3; i++) {
+        BoxCellRange(box, i, &first[i], &last[i]);
+    }
+
+    if (delta > 0) {
+        float face = BoxAxisMax(box, axis);
+        int end = (int)ceilf(face + delta) - 1;
+        for (int layer = (int)ceilf(face - COLLISION_SKIN); layer <= end; layer++) {
+            if (SolidInLayer(map, axis, layer, first, last)) return fminf(delta, layer - face);
+        }
+    } else {
+        float face = BoxAxisMin(box, axis);
+        int end = (int)floorf(face + delta);
+        for (int layer = (int)floorf(face + COLLISION_SKIN) - 1; layer >= end; layer--) {
+            if (SolidInLayer(map, axis, layer, first, last)) return fmaxf(delta, layer + 1 - face);
+        }
+    }
+    return delta;
+}
+
+// Moves box by motion, y first and then x and z, so a box falling against a wall still lands and
+// one walking diagonally into a wall slides along it. Returns the motion that was applied, and
+// blocked[axis] tells whether that axis was cut short.
+Vector3 MoveBox(const ChunkMap *map, BoundingBox *box, Vector3 motion, bool blocked[3]) {
+    float wanted[3] = { motion.x, motion.y, motion.z };
+    float moved[3] = { 0, 0, 0 };
+    const int order[3] = { 1, 0, 2 };
+
+    for (int i = 0; i < 3; i++) {
+        int axis = order[i];
+        moved[axis] = SweepBoxAxis(map, *box, axis, wanted[axis]);
+        blocked[axis] = moved[axis] != wanted[axis];
+
+        Vector3 offset = { axis == 0 ? moved[0] : 0, axis == 1 ? moved[1] : 0, axis == 2 ? moved[2] : 0 };
+        box->min = Vector3Add(box->min, offset);
+        box->max = Vector3Add(box->max, offset);
+    }
+    return (Vector3){ moved[0], moved[1], moved[2] };
+}
+
+// True when the box overlaps block x, y, z, touching faces excluded
+static inline bool BoxOverlapsBlock(BoundingBox box, int x, int y, int z) {
+    return box.min.x + COLLISION_SKIN < x + 1 && box.max.x - COLLISION_SKIN > x &&
+           box.min.y + COLLISION_SKIN < y + 1 && box.max.y - COLLISION_SKIN > y &&
+           box.min.z + COLLISION_SKIN < z + 1 && box.max.z - COLLISION_SKIN > z;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+// Instruction sets of the CPU the game runs on. The paths that use optional ones are compiled for
+// them with a target attribute and picked at run time, so one build runs on any x86-64 CPU and
+// still uses AVX2 or SSE4.2 where they exist.
+
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+    #include <immintrin.h>
+    #define CPU_X86
+#endif
+
+typedef struct {
+    bool sse42;
+    bool avx;
+    bool avx2;
+} CpuFeatures;
+
+CpuFeatures cpu = { 0 };
+
+// Fills in cpu. Call once before threads start, until then every optional path is skipped.
+void CpuInit() {
+#if defined(CPU_X86)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return;
+    cpu.sse42 = (ecx & bit_SSE4_2) != 0;
+
+    // AVX also needs the OS to save the upper halves of the registers on a context switch
+    bool osSavesAvx = false;
+    if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+        unsigned int low, high;
+        __asm__ volatile ("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        osSavesAvx = (low & 6) == 6;
+    }
+    cpu.avx = osSavesAvx;
+
+    if (osSavesAvx && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        cpu.avx2 = (ebx & bit_AVX2) != 0;
+    }
+#endif
+}
\ No newline at end of file
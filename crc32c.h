@@ -0,0 +1,74 @@
+// CRC32C (Castagnoli) checksums, with the SSE4.2 crc32 instruction on CPUs that have it and
+// slicing-by-8 tables otherwise. Both produce the same values.
+
+#if defined(CPU_X86) && defined(__x86_64__)
+    #define CRC32C_HARDWARE
+#endif
+
+#define CRC32C_POLY 0x82F63B78u  // Reflected Castagnoli polynomial
+
+uint32_t crc32cTable[8][256];
+bool crc32cTableReady = false;
+
+// Builds the fallback tables. Call once before threads use Crc32c.
+void Crc32cInit() {
+    for (int i = 0; i < 256; i++) {
+        uint32_t crc = (uint32_t)i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1)));
+        }
+        crc32cTable[0][i] = crc;
+    }
+
+    for (int i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            uint32_t previous = crc32cTable[k - 1][i];
+            crc32cTable[k][i] = (previous >> 8) ^ crc32cTable[0][previous & 0xFF];
+        }
+    }
+    crc32cTableReady = true;
+}
+
+#if defined(CRC32C_HARDWARE)
+__attribute__((target("sse4.2")))
+static uint32_t Crc32cHardware(const unsigned char *bytes, size_t size, uint32_t crc) {
+    uint64_t wide = crc;
+    for (; size >= 8; size -= 8, bytes += 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        wide = _mm_crc32_u64(wide, word);
+    }
+    crc = (uint32_t)wide;
+
+    for (; size > 0; size--) {
+        crc = _mm_crc32_u8(crc, *bytes++);
+    }
+    return crc;
+}
+#endif
+
+uint32_t Crc32c(const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint32_t crc = 0xFFFFFFFFu;
+
+#if defined(CRC32C_HARDWARE)
+    if (cpu.sse42) return ~Crc32cHardware(bytes, size, crc);
+#endif
+    if (!crc32cTableReady) Crc32cInit();
+
+    // Eight bytes per step, one table per byte position. Words load little endian.
+    for (; size >= 8; size -= 8, bytes += 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        word ^= crc;
+        crc = crc32cTable[7][word & 0xFF] ^ crc32cTable[6][(word >> 8) & 0xFF] ^
+              crc32cTable[5][(word >> 16) & 0xFF] ^ crc32cTable[4][(word >> 24) & 0xFF] ^
+              crc32cTable[3][(word >> 32) & 0xFF] ^ crc32cTable[2][(word >> 40) & 0xFF] ^
+              crc32cTable[1][(word >> 48) & 0xFF] ^ crc32cTable[0][word >> 56];
+    }
+
+    for (; size > 0; size--) {
+        crc = (crc >> 8) ^ crc32cTable[0][(crc ^ *bytes++) & 0xFF];
+    }
+    return ~crc;
+}
\ No newline at end of file
@@ -1,69 +1,462 @@
-typedef struct DDACursor {
-    Vector3 mask;
-    Vector3 mapPos;
-    Vector3 rayDir;
-    Vector3 deltaDist;
-    Vector3 sideDist;
-    Vector3 step;
-} DDACursor;
-
-DDACursor DDACursorCreate(Vector3 pos, Vector3 rayDir) {
-    DDACursor cursor;
-
-    cursor.mapPos = (Vector3){ floor(pos.x), floor(pos.y), floor(pos.z) };
-    cursor.rayDir = rayDir;
-
-    cursor.deltaDist = (Vector3){
-        (rayDir.x == 0) ? INFINITY : fabs(1.0f / rayDir.x),
-        (rayDir.y == 0) ? INFINITY : fabs(1.0f / rayDir.y),
-        (rayDir.z == 0) ? INFINITY : fabs(1.0f / rayDir.z)
-    };
-
-    cursor.step = (Vector3){
-        (rayDir.x < 0) ? -1.0f : 1.0f,
-        (rayDir.y < 0) ? -1.0f : 1.0f,
-        (rayDir.z < 0) ? -1.0f : 1.0f
-    };
-
-    cursor.sideDist = (Vector3){
-        (rayDir.x < 0) ? (pos.x - cursor.mapPos.x) * cursor.deltaDist.x : (cursor.mapPos.x + 1.0f - pos.x) * cursor.deltaDist.x,
-        (rayDir.y < 0) ? (pos.y - cursor.mapPos.y) * cursor.deltaDist.y : (cursor.mapPos.y + 1.0f - pos.y) * cursor.deltaDist.y,
-        (rayDir.z < 0) ? (pos.z - cursor.mapPos.z) * cursor.deltaDist.z : (cursor.mapPos.z + 1.0f - pos.z) * cursor.deltaDist.z
-    };
-
-    cursor.mask = (Vector3){ 0, 0, 0 };
-
-    return cursor;
+#include <limits.h>
+
+// Hierarchical ray cast in integer arithmetic. Positions are fixed point with DDA_FIXED_SHIFT
+// fractional bits and the unit direction is scaled to DDA_DIRECTION_ONE, so which boundary comes
+// first is decided by exact 64-bit cross multiplication rather than float compares. The direction
+// keeps 30 bits because grazing rays magnify its rounding; products stay within 64 bits for rays
+// up to about 10000 blocks. Each step crosses the
+// largest empty cell around the ray: a chunk that is not loaded, a section or a brick with nothing
+// but air in the occupancy mips, or a single block, so open air is crossed a few blocks at a time.
+#define DDA_FIXED_SHIFT 16
+#define DDA_FIXED_ONE (1 << DDA_FIXED_SHIFT)
+#define DDA_DIRECTION_ONE (1 << 30)
+
+typedef struct {
+    bool hit;
+    int x, y, z;       // Block that was hit
+    int block;         // Its id
+    Vector3 normal;    // Outward normal of the face the ray entered it through
+    Vector3 position;  // Where the ray entered it
+    float distance;    // From the origin to position
+    int steps;         // Cells crossed, of any size
+} DDAHit;
+
+// Cell holding a fixed point coordinate. A ray leaving a cell backwards sits exactly on its lower
+// boundary, which already belongs to the next cell.
+static inline int64_t DDACell(int64_t position, int direction) {
+    return (direction < 0 ? position - 1 : position) >> DDA_FIXED_SHIFT;
+}
+
+// One ray walking the grid. DDACast and the batched lanes both start, step and finish rays through
+// the functions below, so they cross exactly the same cells and report the same hits.
+typedef struct {
+    Vector3 origin;
+    int64_t start[3], p[3];  // Fixed point start and current position
+    int d[3];
+    int major;               // Axis the ray moves along fastest
+    int64_t limit;           // Displacement along the major axis at maxDistance, in fixed point
+    int axis;                // Axis of the face the ray entered its cell through, -1 in the start block
+    int steps;               // Cells crossed, of any size
+} DDARay;
+
+// False when the direction is zero, the ray then misses
+static inline bool DDARayStart(DDARay *ray, Vector3 origin, Vector3 direction, float maxDistance) {
+    double length = sqrt((double)direction.x * direction.x + (double)direction.y * direction.y + (double)direction.z * direction.z);
+    if (length == 0) return false;
+
+    double o[3] = { origin.x, origin.y, origin.z };
+    double dir[3] = { direction.x / length, direction.y / length, direction.z / length };
+    ray->major = 0;
+    for (int i = 0; i < 3; i++) {
+        ray->start[i] = ray->p[i] = (int64_t)floor(o[i] * DDA_FIXED_ONE);
+        ray->d[i] = (int)lround(dir[i] * DDA_DIRECTION_ONE);
+        if (abs(ray->d[i]) > abs(ray->d[ray->major])) ray->major = i;
+    }
+
+    ray->origin = origin;
+    ray->limit = (int64_t)((double)maxDistance * fabs(dir[ray->major]) * DDA_FIXED_ONE);
+    ray->axis = -1;
+    ray->steps = 0;
+    return true;
 }
 
-Vector3 DDACursorStep(DDACursor *cursor) {
-    if (cursor->sideDist.x < cursor->sideDist.y && cursor->sideDist.x < cursor->sideDist.z) {
-        cursor->sideDist.x += cursor->deltaDist.x;
-        cursor->mapPos.x += cursor->step.x;
-        cursor->mask = (Vector3){ 1, 0, 0 };
-    } else if (cursor->sideDist.y < cursor->sideDist.z) {
-        cursor->sideDist.y += cursor->deltaDist.y;
-        cursor->mapPos.y += cursor->step.y;
-        cursor->mask = (Vector3){ 0, 1, 0 };
-    } else {
-        cursor->sideDist.z += cursor->deltaDist.z;
-        cursor->mapPos.z += cursor->step.z;
-        cursor->mask = (Vector3){ 0, 0, 1 };
+static inline void DDARayCell(const DDARay *ray, int64_t cell[3]) {
+    for (int i = 0; i < 3; i++) {
+        cell[i] = DDACell(ray->p[i], ray->d[i]);
     }
+}
+
+// Moves the ray onto the far side of the cell of 1 << shift blocks holding cell. False once the
+// ray is past its distance.
+static inline bool DDARayStep(DDARay *ray, const int64_t cell[3], int shift) {
+    ray->steps++;
+
+    // Distance to the far side of the cell on each axis. Comparing remaining[i] / |d[i]|
+    // across axes is done as remaining[i] * |d[j]| < remaining[j] * |d[i]|.
+    const int *d = ray->d;
+    int64_t remaining[3];
+    int axis = -1;
+    for (int i = 0; i < 3; i++) {
+        if (d[i] == 0) continue;
+
+        int64_t base = cell[i] & ~(((int64_t)1 << shift) - 1);
+        int64_t boundary = (d[i] > 0 ? base + ((int64_t)1 << shift) : base) * DDA_FIXED_ONE;
+        remaining[i] = d[i] > 0 ? boundary - ray->p[i] : ray->p[i] - boundary;
+        if (axis < 0 || remaining[i] * abs(d[axis]) < remaining[axis] * abs(d[i])) axis = i;
+    }
+
+    // Step onto that boundary. The other axes follow from the ray through the origin, so
+    // rounding does not build up, and truncation keeps them inside their cells.
+    ray->p[axis] += d[axis] > 0 ? remaining[axis] : -remaining[axis];
+    int64_t travel = ray->p[axis] - ray->start[axis];
+    for (int i = 0; i < 3; i++) {
+        if (i != axis) ray->p[i] = ray->start[i] + travel * d[i] / d[axis];
+    }
+    ray->axis = axis;
+
+    return llabs(ray->p[ray->major] - ray->start[ray->major]) <= ray->limit;
+}
+
+static void DDARayHit(const DDARay *ray, const int64_t cell[3], int block, DDAHit *hit) {
+    float normal[3] = { 0 };
+    if (ray->axis >= 0) normal[ray->axis] = ray->d[ray->axis] > 0 ? -1.0f : 1.0f;
 
-    return cursor->mapPos;
+    hit->hit = true;
+    hit->x = (int)cell[0];
+    hit->y = (int)cell[1];
+    hit->z = (int)cell[2];
+    hit->block = block;
+    hit->normal = (Vector3){ normal[0], normal[1], normal[2] };
+    hit->position = (Vector3){ ray->p[0] / (float)DDA_FIXED_ONE, ray->p[1] / (float)DDA_FIXED_ONE, ray->p[2] / (float)DDA_FIXED_ONE };
+    hit->distance = Vector3Distance(hit->position, ray->origin);
+    hit->steps = ray->steps;
 }
 
-Vector3 DDACursorGetNormal(DDACursor *cursor) {
-    Vector3 normal = {0};
+// First non-air block along the ray whose entry point is within maxDistance. The block holding the
+// origin is skipped.
+DDAHit DDACast(const ChunkMap *map, Vector3 origin, Vector3 direction, float maxDistance) {
+    DDAHit hit = { 0 };
+    DDARay ray;
+    if (!DDARayStart(&ray, origin, direction, maxDistance)) return hit;
 
-    if (cursor->mask.x != 0) {
-        normal.x = -cursor->step.x;
-    } else if (cursor->mask.y != 0) {
-        normal.y = -cursor->step.y;
-    } else if (cursor->mask.z != 0) {
-        normal.z = -cursor->step.z;
+    for (bool first = true;; first = false) {
+        int64_t cell[3];
+        DDARayCell(&ray, cell);
+
+        // log2 of the empty cell to cross, 0 for a single block
+        int shift = 0;
+        if (!first) {
+            Chunk *chunk = FindChunk(map, (int)(cell[0] >> CHUNK_SHIFT), (int)(cell[1] >> CHUNK_SHIFT), (int)(cell[2] >> CHUNK_SHIFT));
+            if (chunk == NULL) {
+                shift = CHUNK_SHIFT;
+            } else {
+                int lx = (int)cell[0] & (CHUNK_SIZE - 1);
+                int ly = (int)cell[1] & (CHUNK_SIZE - 1);
+                int lz = (int)cell[2] & (CHUNK_SIZE - 1);
+                uint64_t bricks = chunk->occupancy[SectionIndex(lx >> SECTION_SHIFT, ly >> SECTION_SHIFT, lz >> SECTION_SHIFT)];
+
+                if (bricks == 0) {
+                    shift = SECTION_SHIFT;
+                } else if ((bricks & BrickBit(lx, ly, lz)) == 0) {
+                    shift = BRICK_SHIFT;
+                } else {
+                    int block = PackedBlocksGet(&chunk->blocks, ChunkIndex(lx, ly, lz));
+                    if (block != 0) {
+                        DDARayHit(&ray, cell, block, &hit);
+                        return hit;
+                    }
+                }
+            }
+        }
+
+        if (!DDARayStep(&ray, cell, shift)) {
+            hit.steps = ray.steps;
+            return hit;
+        }
     }
+}
+
+// Casts for many queries at once, such as visibility checks. On CPUs with AVX2, DDA_BATCH rays walk
+// side by side, each lane on its own ray. The occupancy mips of all eight cells are gathered and
+// tested together, only lanes inside an occupied brick read their block, and each lane's chunk is
+// looked up again only when its ray leaves it. A lane whose ray has finished takes the next one
+// right away, so short rays do not leave lanes idle while a long one is still walking. The lanes step
+// in the integer arithmetic of DDARayStep, so hits are exactly those of DDACast. Without AVX2 every
+// ray goes through DDACast.
+#define DDA_BATCH 8
+
+#if defined(CPU_X86)
+// Longest ray a lane casts, in fixed point. Displacements then fit in 32 bits, which the vector
+// step multiplies and divides in. Longer rays go through DDACast.
+#define DDA_LANE_LIMIT ((int64_t)1 << 30)
+
+// The rays of the lanes, the fields of DDARay one array per lane
+typedef struct {
+    int ray[DDA_BATCH];  // Index of the ray each lane is casting
+    Vector3 origin[DDA_BATCH];
+    int64_t start[3][DDA_BATCH], p[3][DDA_BATCH];
+    int d[3][DDA_BATCH];
+    int major[DDA_BATCH];
+    int64_t limit[DDA_BATCH];
+    int axis[DDA_BATCH];
+    int steps[DDA_BATCH];
+    int cell[3][DDA_BATCH];  // Cell the lane's ray is in
+
+    // Last chunk each lane looked up. Lanes in chunks that are not loaded point at ddaNoOccupancy.
+    int chunkKey[3][DDA_BATCH];
+    const Chunk *chunk[DDA_BATCH];
+    const uint64_t *occupancy[DDA_BATCH];
+    int loaded[DDA_BATCH];  // -1 when chunk is loaded
+} DDALanes;
+
+static const uint64_t ddaNoOccupancy[SECTION_COUNT] = { 0 };
+
+static void DDALaneSet(DDALanes *lanes, int i, const DDARay *ray) {
+    int64_t cell[3];
+    DDARayCell(ray, cell);
+    lanes->origin[i] = ray->origin;
+    for (int a = 0; a < 3; a++) {
+        lanes->start[a][i] = ray->start[a];
+        lanes->p[a][i] = ray->p[a];
+        lanes->d[a][i] = ray->d[a];
+        lanes->cell[a][i] = (int)cell[a];
+    }
+    lanes->major[i] = ray->major;
+    lanes->limit[i] = ray->limit;
+    lanes->axis[i] = ray->axis;
+    lanes->steps[i] = ray->steps;
+}
+
+static void DDALaneGet(const DDALanes *lanes, int i, DDARay *ray) {
+    ray->origin = lanes->origin[i];
+    for (int a = 0; a < 3; a++) {
+        ray->start[a] = lanes->start[a][i];
+        ray->p[a] = lanes->p[a][i];
+        ray->d[a] = lanes->d[a][i];
+    }
+    ray->major = lanes->major[i];
+    ray->limit = lanes->limit[i];
+    ray->axis = lanes->axis[i];
+    ray->steps = lanes->steps[i];
+}
+
+// All bits set in the lanes whose bit is set in mask
+__attribute__((target("avx2")))
+static inline __m256i DDALaneMask(int mask) {
+    const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(mask), bits), bits);
+}
+
+// Low halves of four 64 bit lanes
+__attribute__((target("avx2")))
+static inline __m128i DDALow32(__m256i v) {
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+}
 
-    return normal;
+// DDARayStep for lanes 4 * half to 4 * half + 3, in 64 bit lanes, across cells of 1 << shift blocks.
+// Returns the mask of those lanes still within their distance.
+__attribute__((target("avx2")))
+static int DDALaneStep(DDALanes *lanes, int half, __m128i shift) {
+    int o = half * 4;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi64x(1);
+    __m256i size = _mm256_sllv_epi64(one, _mm256_cvtepi32_epi64(shift));
+    __m256i low = _mm256_sub_epi64(size, one);
+
+    __m256i start[3], p[3], d[3], absD[3], negative[3], remaining[3];
+    __m256i axis = _mm256_set1_epi64x(-1), nearest = zero, nearestD = zero;
+    for (int a = 0; a < 3; a++) {
+        start[a] = _mm256_loadu_si256((const __m256i *)&lanes->start[a][o]);
+        p[a] = _mm256_loadu_si256((const __m256i *)&lanes->p[a][o]);
+        __m128i d32 = _mm_loadu_si128((const __m128i *)&lanes->d[a][o]);
+        d[a] = _mm256_cvtepi32_epi64(d32);
+        absD[a] = _mm256_cvtepi32_epi64(_mm_abs_epi32(d32));
+        negative[a] = _mm256_cmpgt_epi64(zero, d[a]);
+
+        __m256i base = _mm256_andnot_si256(low, _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)&lanes->cell[a][o])));
+        __m256i boundary = _mm256_slli_epi64(_mm256_blendv_epi8(_mm256_add_epi64(base, size), base, negative[a]), DDA_FIXED_SHIFT);
+        remaining[a] = _mm256_blendv_epi8(_mm256_sub_epi64(boundary, p[a]), _mm256_sub_epi64(p[a], boundary), negative[a]);
+
+        // Remaining distances are below 2^32, so the products are exact. Ties keep the lower axis.
+        __m256i nearer = _mm256_cmpgt_epi64(_mm256_mul_epu32(nearest, absD[a]), _mm256_mul_epu32(remaining[a], nearestD));
+        __m256i take = _mm256_andnot_si256(_mm256_cmpeq_epi64(d[a], zero), _mm256_or_si256(_mm256_cmpgt_epi64(zero, axis), nearer));
+        axis = _mm256_blendv_epi8(axis, _mm256_set1_epi64x(a), take);
+        nearest = _mm256_blendv_epi8(nearest, remaining[a], take);
+        nearestD = _mm256_blendv_epi8(nearestD, absD[a], take);
+    }
+
+    // Onto the boundary along that axis
+    __m256i isAxis[3], travel = zero, dAxis = zero;
+    for (int a = 0; a < 3; a++) {
+        isAxis[a] = _mm256_cmpeq_epi64(axis, _mm256_set1_epi64x(a));
+        __m256i moved = _mm256_blendv_epi8(_mm256_add_epi64(p[a], remaining[a]), _mm256_sub_epi64(p[a], remaining[a]), negative[a]);
+        p[a] = _mm256_blendv_epi8(p[a], moved, isAxis[a]);
+        travel = _mm256_blendv_epi8(travel, _mm256_sub_epi64(p[a], start[a]), isAxis[a]);
+        dAxis = _mm256_blendv_epi8(dAxis, d[a], isAxis[a]);
+    }
+
+    // The other axes get start + travel * d / dAxis truncated, like DDARayStep. The quotient in
+    // double is within one of that, the remainder of the exact product puts it right.
+    __m128i travel32 = DDALow32(travel), dAxis32 = DDALow32(dAxis);
+    __m256d travelDouble = _mm256_cvtepi32_pd(travel32), dAxisDouble = _mm256_cvtepi32_pd(dAxis32);
+    __m256i dAxisNegative = _mm256_cmpgt_epi64(zero, dAxis);
+    __m256i absDAxis = _mm256_sub_epi64(_mm256_xor_si256(dAxis, dAxisNegative), dAxisNegative);
+    for (int a = 0; a < 3; a++) {
+        __m256i numerator = _mm256_mul_epi32(travel, d[a]);
+        __m128i q32 = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_mul_pd(travelDouble, _mm256_cvtepi32_pd(DDALow32(d[a]))), dAxisDouble));
+        __m256i q = _mm256_cvtepi32_epi64(q32);
+        __m256i r = _mm256_sub_epi64(numerator, _mm256_mul_epi32(q, dAxis));
+
+        __m256i numeratorNegative = _mm256_cmpgt_epi64(zero, numerator);
+        __m256i rNegative = _mm256_cmpgt_epi64(zero, r);
+        __m256i absR = _mm256_sub_epi64(_mm256_xor_si256(r, rNegative), rNegative);
+        __m256i unit = _mm256_blendv_epi8(one, _mm256_set1_epi64x(-1), _mm256_xor_si256(numeratorNegative, dAxisNegative));
+
+        // One too far from zero leaves a remainder of the other sign, one short leaves a whole dAxis
+        __m256i over = _mm256_andnot_si256(_mm256_cmpeq_epi64(r, zero), _mm256_xor_si256(numeratorNegative, rNegative));
+        __m256i under = _mm256_andnot_si256(_mm256_or_si256(over, _mm256_cmpgt_epi64(absDAxis, absR)), _mm256_set1_epi64x(-1));
+        q = _mm256_sub_epi64(q, _mm256_and_si256(unit, over));
+        q = _mm256_add_epi64(q, _mm256_and_si256(unit, under));
+
+        p[a] = _mm256_blendv_epi8(_mm256_add_epi64(start[a], q), p[a], isAxis[a]);
+    }
+
+    __m256i major = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)&lanes->major[o]));
+    __m256i majorTravel = zero;
+    for (int a = 0; a < 3; a++) {
+        _mm256_storeu_si256((__m256i *)&lanes->p[a][o], p[a]);
+
+        // DDACell, the low 32 bits are the same under a logical shift
+        __m256i cell = _mm256_srli_epi64(_mm256_add_epi64(p[a], negative[a]), DDA_FIXED_SHIFT);
+        _mm_storeu_si128((__m128i *)&lanes->cell[a][o], DDALow32(cell));
+        majorTravel = _mm256_blendv_epi8(majorTravel, _mm256_sub_epi64(p[a], start[a]), _mm256_cmpeq_epi64(major, _mm256_set1_epi64x(a)));
+    }
+    _mm_storeu_si128((__m128i *)&lanes->axis[o], DDALow32(axis));
+
+    __m256i majorNegative = _mm256_cmpgt_epi64(zero, majorTravel);
+    majorTravel = _mm256_sub_epi64(_mm256_xor_si256(majorTravel, majorNegative), majorNegative);
+    __m256i limit = _mm256_loadu_si256((const __m256i *)&lanes->limit[o]);
+    return ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(majorTravel, limit))) & 0xF;
+}
+
+__attribute__((target("avx2")))
+static void DDACastLanes(const ChunkMap *map, const Vector3 *origins, const Vector3 *directions, const float *maxDistances, int count, DDAHit *hits) {
+    DDALanes lanes = { 0 };
+    for (int i = 0; i < DDA_BATCH; i++) {
+        lanes.chunkKey[0][i] = lanes.chunkKey[1][i] = lanes.chunkKey[2][i] = INT_MIN;
+        lanes.occupancy[i] = ddaNoOccupancy;
+    }
+
+    int active = 0;  // Lanes with a ray
+    int fresh = 0;   // Lanes whose ray is still in its start block, which is skipped
+    int next = 0;
+
+    const __m256i localMask = _mm256_set1_epi32(CHUNK_SIZE - 1);
+    const __m256i brickMask = _mm256_set1_epi32((1 << SECTION_BRICK_SHIFT) - 1);
+
+    while (true) {
+        for (int free = ~active & 0xFF; free != 0 && next < count; free &= free - 1) {
+            int i = __builtin_ctz(free);
+            while (next < count) {
+                int index = next++;
+                DDARay ray;
+                if (!DDARayStart(&ray, origins[index], directions[index], maxDistances[index])) {
+                    hits[index] = (DDAHit){ 0 };
+                } else if (ray.limit > DDA_LANE_LIMIT) {
+                    hits[index] = DDACast(map, origins[index], directions[index], maxDistances[index]);
+                } else {
+                    hits[index] = (DDAHit){ 0 };
+                    lanes.ray[i] = index;
+                    DDALaneSet(&lanes, i, &ray);
+                    active |= 1 << i;
+                    fresh |= 1 << i;
+                    break;
+                }
+            }
+        }
+        if (active == 0) break;
+
+        __m256i cell[3];
+        for (int a = 0; a < 3; a++) {
+            cell[a] = _mm256_loadu_si256((const __m256i *)lanes.cell[a]);
+        }
+
+        // Look up chunks again only for the lanes that crossed into another one
+        int classify = active & ~fresh;
+        int sameChunk = 0xFF;
+        for (int a = 0; a < 3; a++) {
+            __m256i key = _mm256_loadu_si256((const __m256i *)lanes.chunkKey[a]);
+            sameChunk &= _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_srai_epi32(cell[a], CHUNK_SHIFT), key)));
+        }
+        for (int moved = classify & ~sameChunk; moved != 0; moved &= moved - 1) {
+            int i = __builtin_ctz(moved);
+            int cx = lanes.cell[0][i] >> CHUNK_SHIFT, cy = lanes.cell[1][i] >> CHUNK_SHIFT, cz = lanes.cell[2][i] >> CHUNK_SHIFT;
+            const Chunk *chunk = ChunkMapGet(map, cx, cy, cz);
+            lanes.chunkKey[0][i] = cx;
+            lanes.chunkKey[1][i] = cy;
+            lanes.chunkKey[2][i] = cz;
+            lanes.chunk[i] = chunk;
+            lanes.occupancy[i] = chunk != NULL ? chunk->occupancy : ddaNoOccupancy;
+            lanes.loaded[i] = chunk != NULL ? -1 : 0;
+        }
+
+        // Section and brick of every lane's cell, then the section's occupancy word, four lanes per gather
+        __m256i local[3];
+        for (int a = 0; a < 3; a++) {
+            local[a] = _mm256_and_si256(cell[a], localMask);
+        }
+        __m256i section = _mm256_or_si256(_mm256_srli_epi32(local[0], SECTION_SHIFT),
+            _mm256_or_si256(_mm256_slli_epi32(_mm256_srli_epi32(local[1], SECTION_SHIFT), CHUNK_SECTION_SHIFT),
+                _mm256_slli_epi32(_mm256_srli_epi32(local[2], SECTION_SHIFT), 2 * CHUNK_SECTION_SHIFT)));
+        __m256i brick = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(local[0], BRICK_SHIFT), brickMask),
+            _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(local[1], BRICK_SHIFT), brickMask), SECTION_BRICK_SHIFT),
+                _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(local[2], BRICK_SHIFT), brickMask), 2 * SECTION_BRICK_SHIFT)));
+
+        __m256i gatherMask = DDALaneMask(classify);
+        int emptySection = 0, emptyBrick = 0;
+        for (int half = 0; half < 2; half++) {
+            __m128i sectionHalf = half ? _mm256_extracti128_si256(section, 1) : _mm256_castsi256_si128(section);
+            __m128i brickHalf = half ? _mm256_extracti128_si256(brick, 1) : _mm256_castsi256_si128(brick);
+            __m128i maskHalf = half ? _mm256_extracti128_si256(gatherMask, 1) : _mm256_castsi256_si128(gatherMask);
+
+            __m256i address = _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)&lanes.occupancy[half * 4]),
+                _mm256_slli_epi64(_mm256_cvtepi32_epi64(sectionHalf), 3));
+            __m256i words = _mm256_mask_i64gather_epi64(_mm256_setzero_si256(), NULL, address, _mm256_cvtepi32_epi64(maskHalf), 1);
+            __m256i bit = _mm256_and_si256(_mm256_srlv_epi64(words, _mm256_cvtepi32_epi64(brickHalf)), _mm256_set1_epi64x(1));
+
+            emptySection |= _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(words, _mm256_setzero_si256()))) << half * 4;
+            emptyBrick |= _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(bit, _mm256_setzero_si256()))) << half * 4;
+        }
+        int loaded = _mm256_movemask_ps(_mm256_loadu_ps((const float *)lanes.loaded));
+
+        // Lanes in an occupied brick read their block, a solid one ends the ray
+        for (int solid = classify & loaded & ~emptyBrick & ~emptySection; solid != 0; solid &= solid - 1) {
+            int i = __builtin_ctz(solid);
+            int x = lanes.cell[0][i] & (CHUNK_SIZE - 1), y = lanes.cell[1][i] & (CHUNK_SIZE - 1), z = lanes.cell[2][i] & (CHUNK_SIZE - 1);
+            int block = PackedBlocksGet(&lanes.chunk[i]->blocks, ChunkIndex(x, y, z));
+            if (block != 0) {
+                DDARay ray;
+                DDALaneGet(&lanes, i, &ray);
+                int64_t hitCell[3] = { lanes.cell[0][i], lanes.cell[1][i], lanes.cell[2][i] };
+                DDARayHit(&ray, hitCell, block, &hits[lanes.ray[i]]);
+                active &= ~(1 << i);
+            }
+        }
+        fresh = 0;
+
+        // Every other lane crosses the largest empty cell around it like DDACast: a chunk that is not
+        // loaded, an empty section or brick, or a single block, which is all lanes in their start block cross
+        __m256i shift = _mm256_setzero_si256();
+        shift = _mm256_blendv_epi8(shift, _mm256_set1_epi32(BRICK_SHIFT), DDALaneMask(classify & emptyBrick));
+        shift = _mm256_blendv_epi8(shift, _mm256_set1_epi32(SECTION_SHIFT), DDALaneMask(classify & emptySection));
+        shift = _mm256_blendv_epi8(shift, _mm256_set1_epi32(CHUNK_SHIFT), DDALaneMask(classify & ~loaded));
+
+        __m256i steps = _mm256_loadu_si256((const __m256i *)lanes.steps);
+        _mm256_storeu_si256((__m256i *)lanes.steps, _mm256_sub_epi32(steps, DDALaneMask(active)));
+
+        int inside = DDALaneStep(&lanes, 0, _mm256_castsi256_si128(shift));
+        inside |= DDALaneStep(&lanes, 1, _mm256_extracti128_si256(shift, 1)) << 4;
+
+        // Past their distance, a miss
+        for (int missed = active & ~inside; missed != 0; missed &= missed - 1) {
+            int i = __builtin_ctz(missed);
+            hits[lanes.ray[i]].steps = lanes.steps[i];
+        }
+        active &= inside;
+    }
+}
+#endif
+
+// Casts count rays into hits, ray i from origins[i] along directions[i] up to maxDistances[i]
+void DDACastBatch(const ChunkMap *map, const Vector3 *origins, const Vector3 *directions, const float *maxDistances, int count, DDAHit *hits) {
+    PROFILE_ZONE("DDACastBatch");
+#if defined(CPU_X86)
+    if (cpu.avx2) {
+        DDACastLanes(map, origins, directions, maxDistances, count, hits);
+        return;
+    }
+#endif
+    for (int i = 0; i < count; i++) {
+        hits[i] = DDACast(map, origins[i], directions[i], maxDistances[i]);
+    }
 }
\ No newline at end of file
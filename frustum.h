@@ -0,0 +1,124 @@
+// View frustum culling of axis aligned boxes, eight boxes per batch with AVX when the CPU has it
+
+#define CULL_BATCH 8
+
+typedef struct {
+    // Plane i is a * x + b * y + c * z + d >= 0 on the inside, stored as { a, b, c, d }
+    Vector4 planes[6];
+} Frustum;
+
+// Boxes in structure of arrays layout, capacity is kept a multiple of CULL_BATCH
+typedef struct {
+    float *minX, *minY, *minZ;
+    float *maxX, *maxY, *maxZ;
+    int count;
+    int capacity;
+} BoxList;
+
+typedef struct {
+    int tested;
+    int drawn;
+} CullStats;
+
+// Extracts the planes from a combined view-projection matrix (Gribb-Hartmann)
+Frustum FrustumFromMatrix(Matrix m) {
+    Vector4 row0 = { m.m0, m.m4, m.m8, m.m12 };
+    Vector4 row1 = { m.m1, m.m5, m.m9, m.m13 };
+    Vector4 row2 = { m.m2, m.m6, m.m10, m.m14 };
+    Vector4 row3 = { m.m3, m.m7, m.m11, m.m15 };
+
+    Frustum frustum;
+    frustum.planes[0] = (Vector4){ row3.x + row0.x, row3.y + row0.y, row3.z + row0.z, row3.w + row0.w };
+    frustum.planes[1] = (Vector4){ row3.x - row0.x, row3.y - row0.y, row3.z - row0.z, row3.w - row0.w };
+    frustum.planes[2] = (Vector4){ row3.x + row1.x, row3.y + row1.y, row3.z + row1.z, row3.w + row1.w };
+    frustum.planes[3] = (Vector4){ row3.x - row1.x, row3.y - row1.y, row3.z - row1.z, row3.w - row1.w };
+    frustum.planes[4] = (Vector4){ row3.x + row2.x, row3.y + row2.y, row3.z + row2.z, row3.w + row2.w };
+    frustum.planes[5] = (Vector4){ row3.x - row2.x, row3.y - row2.y, row3.z - row2.z, row3.w - row2.w };
+    return frustum;
+}
+
+void BoxListReserve(BoxList *list, int count) {
+    if (count <= list->capacity) return;
+
+    int capacity = (count + CULL_BATCH - 1) / CULL_BATCH * CULL_BATCH;
+    float **arrays[6] = { &list->minX, &list->minY, &list->minZ, &list->maxX, &list->maxY, &list->maxZ };
+    for (int i = 0; i < 6; i++) {
+        *arrays[i] = (float*)realloc(*arrays[i], capacity * sizeof(float));
+    }
+    list->capacity = capacity;
+}
+
+void BoxListSet(BoxList *list, int index, Vector3 min, Vector3 max) {
+    list->minX[index] = min.x;
+    list->minY[index] = min.y;
+    list->minZ[index] = min.z;
+    list->maxX[index] = max.x;
+    list->maxY[index] = max.y;
+    list->maxZ[index] = max.z;
+}
+
+void BoxListFree(BoxList *list) {
+    free(list->minX);
+    free(list->minY);
+    free(list->minZ);
+    free(list->maxX);
+    free(list->maxY);
+    free(list->maxZ);
+    *list = (BoxList){ 0 };
+}
+
+// A box is outside when its corner furthest along a plane normal is still behind that plane
+static void CullBoxesScalar(const Frustum *frustum, const BoxList *boxes, unsigned char *visible) {
+    for (int i = 0; i < boxes->count; i++) {
+        bool inside = true;
+
+        for (int p = 0; p < 6 && inside; p++) {
+            Vector4 plane = frustum->planes[p];
+            float x = plane.x >= 0 ? boxes->maxX[i] : boxes->minX[i];
+            float y = plane.y >= 0 ? boxes->maxY[i] : boxes->minY[i];
+            float z = plane.z >= 0 ? boxes->maxZ[i] : boxes->minZ[i];
+            inside = plane.x * x + plane.y * y + plane.z * z + plane.w >= 0;
+        }
+
+        visible[i] = inside;
+    }
+}
+
+#if defined(CPU_X86)
+// The same test for CULL_BATCH boxes at a time
+__attribute__((target("avx")))
+static void CullBoxesAVX(const Frustum *frustum, const BoxList *boxes, unsigned char *visible) {
+    for (int base = 0; base < boxes->count; base += CULL_BATCH) {
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (int p = 0; p < 6; p++) {
+            Vector4 plane = frustum->planes[p];
+            const float *xs = plane.x >= 0 ? boxes->maxX : boxes->minX;
+            const float *ys = plane.y >= 0 ? boxes->maxY : boxes->minY;
+            const float *zs = plane.z >= 0 ? boxes->maxZ : boxes->minZ;
+
+            __m256 dist = _mm256_set1_ps(plane.w);
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(plane.x), _mm256_loadu_ps(xs + base)));
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(plane.y), _mm256_loadu_ps(ys + base)));
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(_mm256_set1_ps(plane.z), _mm256_loadu_ps(zs + base)));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (int i = 0; i < CULL_BATCH && base + i < boxes->count; i++) {
+            visible[base + i] = (mask >> i) & 1;
+        }
+    }
+}
+#endif
+
+// Writes 1 to visible[i] when box i intersects the frustum
+void CullBoxes(const Frustum *frustum, const BoxList *boxes, unsigned char *visible) {
+#if defined(CPU_X86)
+    if (cpu.avx) {
+        CullBoxesAVX(frustum, boxes, visible);
+        return;
+    }
+#endif
+    CullBoxesScalar(frustum, boxes, visible);
+}
\ No newline at end of file
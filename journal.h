@@ -0,0 +1,258 @@
+// Write-ahead journal of block edits. Edits are appended to a memory buffer on the main thread and a
+// worker writes and syncs whatever has gathered in one go, so an edit costs a copy under a lock and
+// every fsync covers a whole batch. On startup the journal is replayed over the saved regions.
+//
+// A save is a checkpoint: the active journal is renamed to journal.old, and once every region save
+// queued up to that point has been written, journal.old is deleted. When one of those saves fails,
+// its chunks are marked dirty again and journal.old waits for the next save, which writes them.
+
+#define JOURNAL_NAME "journal"
+#define JOURNAL_OLD_NAME "journal.old"
+#define JOURNAL_SEED 0x4A524E4Cu
+
+typedef struct {
+    int32_t x, y, z;
+    int32_t oldId;
+    int32_t newId;
+    uint32_t tick;
+    uint32_t check;  // Hash of the fields above, a torn write at the end of the file fails it
+} JournalRecord;
+
+typedef struct {
+    Mutex mutex;
+    CondVar wake;
+    CondVar written;
+    bool running;
+    bool writing;
+
+    JournalRecord *pending;
+    int pendingCount;
+    int pendingCapacity;
+
+    // Records before this index belong in the journal that is being rotated out, -1 when none is
+    int rotateAt;
+    bool discardOld;
+
+    // Main thread only: an old journal exists, and whether a save it waits for has failed since the
+    // last checkpoint
+    bool hasOld;
+    bool saveFailed;
+
+    FILE *file;
+    Thread worker;
+} Journal;
+
+uint32_t JournalCheck(const JournalRecord *record) {
+    const unsigned char *bytes = (const unsigned char *)record;
+    uint32_t hash = 2166136261u ^ JOURNAL_SEED;
+    for (size_t i = 0; i < sizeof(JournalRecord) - sizeof(record->check); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void JournalWrite(Journal *journal, const JournalRecord *records, int count) {
+    if (count == 0 || journal->file == NULL) return;
+
+    if (fwrite(records, sizeof(JournalRecord), count, journal->file) != (size_t)count || !FileSync(journal->file)) {
+        printf("Failed to write edit journal\n");
+    }
+}
+
+void JournalWorker(void *arg) {
+    Journal *journal = (Journal *)arg;
+    JournalRecord *batch = NULL;
+    int batchCapacity = 0;
+    ProfileThreadName("Journal worker");
+
+    MutexLock(&journal->mutex);
+    while (true) {
+        while (journal->running && journal->pendingCount == 0 && journal->rotateAt < 0 && !journal->discardOld) {
+            CondWait(&journal->wake, &journal->mutex);
+        }
+        if (!journal->running && journal->pendingCount == 0 && journal->rotateAt < 0 && !journal->discardOld) break;
+
+        // Swap buffers so the main thread keeps appending while this batch is written
+        JournalRecord *records = journal->pending;
+        int count = journal->pendingCount;
+        int capacity = journal->pendingCapacity;
+        int rotateAt = journal->rotateAt;
+        bool discardOld = journal->discardOld;
+
+        journal->pending = batch;
+        journal->pendingCapacity = batchCapacity;
+        journal->pendingCount = 0;
+        journal->rotateAt = -1;
+        journal->discardOld = false;
+        batch = records;
+        batchCapacity = capacity;
+        journal->writing = true;
+        MutexUnlock(&journal->mutex);
+
+        ProfileZone zone = ProfileBegin("Journal write");
+        if (rotateAt >= 0) {
+            JournalWrite(journal, records, rotateAt);
+            if (journal->file) fclose(journal->file);
+            FileReplace(JOURNAL_NAME, JOURNAL_OLD_NAME);
+            journal->file = fopen(JOURNAL_NAME, "ab");
+            JournalWrite(journal, records + rotateAt, count - rotateAt);
+        } else {
+            JournalWrite(journal, records, count);
+        }
+
+        if (discardOld) remove(JOURNAL_OLD_NAME);
+        ProfileEnd(&zone);
+
+        MutexLock(&journal->mutex);
+        journal->writing = false;
+        CondBroadcast(&journal->written);
+    }
+    MutexUnlock(&journal->mutex);
+
+    free(batch);
+}
+
+static void JournalReadFile(const char *name, JournalRecord **records, int *count, int *capacity) {
+    FILE *file = fopen(name, "rb");
+    if (file == NULL) return;
+
+    JournalRecord record;
+    while (fread(&record, sizeof(record), 1, file) == 1 && record.check == JournalCheck(&record)) {
+        if (*count == *capacity) {
+            *capacity = *capacity ? *capacity * 2 : 256;
+            *records = (JournalRecord *)realloc(*records, *capacity * sizeof(JournalRecord));
+        }
+        (*records)[(*count)++] = record;
+    }
+    fclose(file);
+}
+
+// All intact records, oldest first. Reading stops at the first torn record of each file.
+JournalRecord *JournalRead(int *count) {
+    JournalRecord *records = NULL;
+    int capacity = 0;
+    *count = 0;
+
+    JournalReadFile(JOURNAL_OLD_NAME, &records, count, &capacity);
+    JournalReadFile(JOURNAL_NAME, &records, count, &capacity);
+    return records;
+}
+
+// A crash can leave a torn record at the end of the journal. It is cut off before appending,
+// otherwise every record written after it would be unreadable.
+static void JournalTrim(const char *name) {
+    MappedFile file;
+    if (!MapFile(&file, name)) return;
+
+    int count = 0;
+    JournalRecord *records = NULL;
+    int capacity = 0;
+    JournalReadFile(name, &records, &count, &capacity);
+
+    bool torn = file.size != (size_t)count * sizeof(JournalRecord);
+    UnmapFile(&file);
+
+    if (torn) {
+        char tempName[64];
+        snprintf(tempName, sizeof(tempName), "%s.tmp", name);
+
+        FILE *temp = fopen(tempName, "wb");
+        bool written = temp != NULL;
+        if (temp != NULL) {
+            written = (count == 0 || fwrite(records, sizeof(JournalRecord), count, temp) == (size_t)count) && FileSync(temp);
+            written = fclose(temp) == 0 && written;
+        }
+        if (!written || !FileReplace(tempName, name)) remove(tempName);
+    }
+    free(records);
+}
+
+void JournalInit(Journal *journal) {
+    memset(journal, 0, sizeof(Journal));
+    MutexInit(&journal->mutex);
+    CondInit(&journal->wake);
+    CondInit(&journal->written);
+    journal->running = true;
+    journal->rotateAt = -1;
+
+    FILE *old = fopen(JOURNAL_OLD_NAME, "rb");
+    if (old != NULL) {
+        journal->hasOld = true;
+        fclose(old);
+    }
+
+    JournalTrim(JOURNAL_NAME);
+    journal->file = fopen(JOURNAL_NAME, "ab");
+    if (journal->file == NULL) printf("Failed to open edit journal, edits are only kept by saves\n");
+
+    ThreadCreate(&journal->worker, JournalWorker, journal);
+}
+
+void JournalAppend(Journal *journal, int x, int y, int z, int oldId, int newId, unsigned int tick) {
+    JournalRecord record = { x, y, z, oldId, newId, tick, 0 };
+    record.check = JournalCheck(&record);
+
+    MutexLock(&journal->mutex);
+    if (journal->pendingCount == journal->pendingCapacity) {
+        journal->pendingCapacity = journal->pendingCapacity ? journal->pendingCapacity * 2 : 64;
+        journal->pending = (JournalRecord *)realloc(journal->pending, journal->pendingCapacity * sizeof(JournalRecord));
+    }
+    journal->pending[journal->pendingCount++] = record;
+    CondSignal(&journal->wake);
+    MutexUnlock(&journal->mutex);
+}
+
+// Called right before a save is queued: edits so far move to journal.old, which the save will cover.
+// Skipped while an older journal is still waiting for its saves, the next save rotates instead. If
+// one of those saves failed, this save queues its chunks again, so journal.old waits for it instead.
+void JournalCheckpoint(Journal *journal) {
+    if (journal->hasOld) {
+        journal->saveFailed = false;
+        return;
+    }
+
+    MutexLock(&journal->mutex);
+    journal->rotateAt = journal->pendingCount;
+    CondSignal(&journal->wake);
+    MutexUnlock(&journal->mutex);
+
+    journal->hasOld = true;
+    journal->saveFailed = false;
+}
+
+// Called once every queued save has been written, deletes journal.old unless one of them failed
+void JournalSavesFinished(Journal *journal) {
+    if (!journal->hasOld || journal->saveFailed) return;
+
+    MutexLock(&journal->mutex);
+    journal->discardOld = true;
+    CondSignal(&journal->wake);
+    MutexUnlock(&journal->mutex);
+
+    journal->hasOld = false;
+}
+
+// Waits until every appended edit is on disk
+void JournalFlush(Journal *journal) {
+    MutexLock(&journal->mutex);
+    while (journal->writing || journal->pendingCount > 0 || journal->rotateAt >= 0 || journal->discardOld) {
+        CondWait(&journal->written, &journal->mutex);
+    }
+    MutexUnlock(&journal->mutex);
+}
+
+// Writes out the remaining edits
+void JournalShutdown(Journal *journal) {
+    MutexLock(&journal->mutex);
+    journal->running = false;
+    CondSignal(&journal->wake);
+    MutexUnlock(&journal->mutex);
+
+    ThreadJoin(journal->worker);
+    if (journal->file) fclose(journal->file);
+    free(journal->pending);
+
+    CondDestroy(&journal->wake);
+    CondDestroy(&journal->written);
+    MutexDestroy(&journal->mutex);
+}
\ No newline at end of file
@@ -0,0 +1,399 @@
+// Flood fill lighting. Sky light falls straight down from open sky without fading and spreads
+// sideways and up losing a level per block, block light spreads the same way from glowing blocks.
+// Solid blocks stop both.
+//
+// Light is filled in when a chunk loads and then kept up to date one edit at a time. An edit first
+// clears everything that was lit through the changed block, walking the removal queue outwards
+// until it meets light that comes from elsewhere, then the add queue floods light back in from that
+// edge and from any new source. Only the blocks whose light changes and their neighbors are visited,
+// and only the sections holding them are remeshed.
+
+#define LIGHT_SKY 0
+#define LIGHT_BLOCK 1
+
+typedef struct {
+    int x, y, z;
+    int level;  // Level the block had before it was cleared, removal queue only
+} LightNode;
+
+typedef struct {
+    LightNode *nodes;
+    int head;
+    int count;
+    int capacity;
+} LightQueue;
+
+typedef struct {
+    LightQueue add;
+    LightQueue remove;
+    // World section coordinates of the sections whose light changed, for the caller to remesh and
+    // then clear with LightClearSections
+    int (*sections)[3];
+    int sectionCount;
+    int sectionCapacity;
+} LightEngine;
+
+// +Z, -Z, +Y, -Y, +X, -X like the mesh faces, -Y is the way sky light falls
+static const int lightOffsets[6][3] = { { 0, 0, 1 }, { 0, 0, -1 }, { 0, 1, 0 }, { 0, -1, 0 }, { 1, 0, 0 }, { -1, 0, 0 } };
+#define LIGHT_DOWN 3
+
+// Glowstone, lit furnace, jack o'lantern, lit redstone lamp and lava from the block atlas
+int BlockEmission(int id) {
+    switch (id) {
+        case 56: case 63: case 94: case 137: return LIGHT_MAX;
+        case 40: return 13;
+        default: return 0;
+    }
+}
+
+// Air and sprites let light through
+static inline bool LightPasses(int id) {
+    return id <= 0;
+}
+
+static inline int LightLevel(uint8_t light, int channel) {
+    return channel == LIGHT_SKY ? light >> LIGHT_SKY_SHIFT : light & LIGHT_MAX;
+}
+
+static inline uint8_t LightWithLevel(uint8_t light, int channel, int level) {
+    if (channel == LIGHT_SKY) return (uint8_t)((light & LIGHT_MAX) | level << LIGHT_SKY_SHIFT);
+    return (uint8_t)((light & ~LIGHT_MAX) | level);
+}
+
+// Level that light leaving a block at level has when it reaches the neighbor in direction, an index
+// into lightOffsets. Full sky light keeps its level going down.
+static inline int LightSpreadLevel(int level, int channel, int direction) {
+    if (channel == LIGHT_SKY && direction == LIGHT_DOWN && level == LIGHT_MAX) return LIGHT_MAX;
+    return level - 1;
+}
+
+// Chunk holding world block x, y, z and the block's index in it, NULL when it is not loaded
+static inline Chunk *LightBlockAt(const ChunkMap *map, int x, int y, int z, int *index) {
+    Chunk *chunk = FindChunk(map, x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+    *index = ChunkIndex(x & (CHUNK_SIZE - 1), y & (CHUNK_SIZE - 1), z & (CHUNK_SIZE - 1));
+    return chunk;
+}
+
+static void LightPush(LightQueue *queue, int x, int y, int z, int level) {
+    if (queue->count == queue->capacity) {
+        queue->capacity = queue->capacity ? queue->capacity * 2 : 1024;
+        queue->nodes = (LightNode*)realloc(queue->nodes, queue->capacity * sizeof(LightNode));
+    }
+    queue->nodes[queue->count++] = (LightNode){ x, y, z, level };
+}
+
+static void LightMarkSection(const ChunkMap *map, LightEngine *engine, int sx, int sy, int sz) {
+    Chunk *chunk = FindChunk(map, sx >> CHUNK_SECTION_SHIFT, sy >> CHUNK_SECTION_SHIFT, sz >> CHUNK_SECTION_SHIFT);
+    if (chunk == NULL) return;
+
+    uint64_t bit = 1ull << SectionIndex(sx & (SECTIONS_PER_AXIS - 1), sy & (SECTIONS_PER_AXIS - 1), sz & (SECTIONS_PER_AXIS - 1));
+    if (chunk->relit & bit) return;
+    chunk->relit |= bit;
+
+    if (engine->sectionCount == engine->sectionCapacity) {
+        engine->sectionCapacity = engine->sectionCapacity ? engine->sectionCapacity * 2 : 64;
+        engine->sections = (int(*)[3])realloc(engine->sections, engine->sectionCapacity * sizeof(int[3]));
+    }
+    int *section = engine->sections[engine->sectionCount++];
+    section[0] = sx;
+    section[1] = sy;
+    section[2] = sz;
+}
+
+// Faces are meshed with the light of the block in front of them, which can belong to the section
+// across a border as well as to the block's own
+static void LightMarkBlock(const ChunkMap *map, LightEngine *engine, int x, int y, int z) {
+    int sx = x >> SECTION_SHIFT;
+    int sy = y >> SECTION_SHIFT;
+    int sz = z >> SECTION_SHIFT;
+    int lx = x & (SECTION_SIZE - 1);
+    int ly = y & (SECTION_SIZE - 1);
+    int lz = z & (SECTION_SIZE - 1);
+
+    LightMarkSection(map, engine, sx, sy, sz);
+
+    if (lx == 0) LightMarkSection(map, engine, sx - 1, sy, sz);
+    if (lx == SECTION_SIZE - 1) LightMarkSection(map, engine, sx + 1, sy, sz);
+    if (ly == 0) LightMarkSection(map, engine, sx, sy - 1, sz);
+    if (ly == SECTION_SIZE - 1) LightMarkSection(map, engine, sx, sy + 1, sz);
+    if (lz == 0) LightMarkSection(map, engine, sx, sy, sz - 1);
+    if (lz == SECTION_SIZE - 1) LightMarkSection(map, engine, sx, sy, sz + 1);
+}
+
+// Floods light out of the blocks in the add queue. A block may have changed since it was queued, so
+// its current level is what spreads.
+static void LightFlood(LightEngine *engine, const ChunkMap *map, int channel) {
+    LightQueue *queue = &engine->add;
+
+    while (queue->head < queue->count) {
+        LightNode node = queue->nodes[queue->head++];
+        int index;
+        Chunk *chunk = LightBlockAt(map, node.x, node.y, node.z, &index);
+        if (chunk == NULL) continue;
+
+        int level = LightLevel(ChunkGetLight(chunk, index), channel);
+        if (level <= 1) continue;
+
+        for (int i = 0; i < 6; i++) {
+            int x = node.x + lightOffsets[i][0];
+            int y = node.y + lightOffsets[i][1];
+            int z = node.z + lightOffsets[i][2];
+            Chunk *neighbor = LightBlockAt(map, x, y, z, &index);
+            if (neighbor == NULL || !LightPasses(PackedBlocksGet(&neighbor->blocks, index))) continue;
+
+            int spread = LightSpreadLevel(level, channel, i);
+            uint8_t light = ChunkGetLight(neighbor, index);
+            if (LightLevel(light, channel) >= spread) continue;
+
+            ChunkSetLight(neighbor, index, LightWithLevel(light, channel, spread));
+            LightMarkBlock(map, engine, x, y, z);
+            LightPush(queue, x, y, z, 0);
+        }
+    }
+    queue->head = queue->count = 0;
+}
+
+// Clears the light that spread out of the blocks in the removal queue. A neighbor dimmer than the
+// cleared block was lit through it and is cleared in turn, a brighter one is lit from elsewhere and
+// is queued to flood back in. Glowing solid blocks are always queued to flood, they light themselves.
+static void LightUnflood(LightEngine *engine, const ChunkMap *map, int channel) {
+    LightQueue *queue = &engine->remove;
+
+    while (queue->head < queue->count) {
+        LightNode node = queue->nodes[queue->head++];
+
+        for (int i = 0; i < 6; i++) {
+            int x = node.x + lightOffsets[i][0];
+            int y = node.y + lightOffsets[i][1];
+            int z = node.z + lightOffsets[i][2];
+            int index;
+            Chunk *neighbor = LightBlockAt(map, x, y, z, &index);
+            if (neighbor == NULL) continue;
+
+            uint8_t light = ChunkGetLight(neighbor, index);
+            int level = LightLevel(light, channel);
+            if (level == 0) continue;
+
+            bool litThrough = level < node.level || LightSpreadLevel(node.level, channel, i) == level;
+            if (litThrough && LightPasses(PackedBlocksGet(&neighbor->blocks, index))) {
+                ChunkSetLight(neighbor, index, LightWithLevel(light, channel, 0));
+                LightMarkBlock(map, engine, x, y, z);
+                LightPush(queue, x, y, z, level);
+            } else {
+                LightPush(&engine->add, x, y, z, 0);
+            }
+        }
+    }
+    queue->head = queue->count = 0;
+}
+
+// Brings the light around block x, y, z up to date after SetBlock changed it from oldId to newId
+void LightUpdateBlock(LightEngine *engine, const ChunkMap *map, int x, int y, int z, int oldId, int newId) {
+    // Swapping one clear block for another, or one dark solid block for another, changes no light
+    if (LightPasses(oldId) == LightPasses(newId) && BlockEmission(oldId) == BlockEmission(newId)) return;
+
+    int index;
+    Chunk *chunk = LightBlockAt(map, x, y, z, &index);
+    if (chunk == NULL) return;
+
+    PROFILE_ZONE("LightUpdateBlock");
+    for (int channel = LIGHT_SKY; channel <= LIGHT_BLOCK; channel++) {
+        uint8_t light = ChunkGetLight(chunk, index);
+        int old = LightLevel(light, channel);
+        ChunkSetLight(chunk, index, LightWithLevel(light, channel, 0));
+        LightMarkBlock(map, engine, x, y, z);
+
+        if (old > 0) {
+            LightPush(&engine->remove, x, y, z, old);
+            LightUnflood(engine, map, channel);
+        } else if (LightPasses(newId)) {
+            // An opened block fills in from its neighbors
+            for (int i = 0; i < 6; i++) {
+                LightPush(&engine->add, x + lightOffsets[i][0], y + lightOffsets[i][1], z + lightOffsets[i][2], 0);
+            }
+        }
+
+        if (channel == LIGHT_BLOCK && BlockEmission(newId) > 0) {
+            ChunkSetLight(chunk, index, LightWithLevel(ChunkGetLight(chunk, index), channel, BlockEmission(newId)));
+            LightPush(&engine->add, x, y, z, 0);
+        }
+        LightFlood(engine, map, channel);
+    }
+}
+
+// Queues the blocks on both sides of the face a chunk shares with a loaded neighbor that can light
+// the other side brighter than it is. face is the side of chunk, as an index into lightOffsets.
+// Sky light the neighbor below took from open sky, while chunk was not loaded yet, is queued for
+// removal when chunk does not let it through after all.
+static void LightChunkFace(LightEngine *engine, const ChunkMap *map, const Chunk *chunk, int face, int channel) {
+    Chunk *neighbor = FindChunk(map, chunk->cx + lightOffsets[face][0], chunk->cy + lightOffsets[face][1], chunk->cz + lightOffsets[face][2]);
+    if (neighbor == NULL) return;
+
+    int axis = face < 2 ? 2 : face < 4 ? 1 : 0;
+    bool positive = face % 2 == 0;
+    int ox = chunk->cx * CHUNK_SIZE, oy = chunk->cy * CHUNK_SIZE, oz = chunk->cz * CHUNK_SIZE;
+    // Direction light takes coming into chunk, the opposite face
+    int inward = face ^ 1;
+
+    for (int v = 0; v < CHUNK_SIZE; v++) {
+        for (int u = 0; u < CHUNK_SIZE; u++) {
+            int inside[3], outside[3];
+            inside[axis] = positive ? CHUNK_SIZE - 1 : 0;
+            outside[axis] = positive ? 0 : CHUNK_SIZE - 1;
+            inside[(axis + 1) % 3] = outside[(axis + 1) % 3] = u;
+            inside[(axis + 2) % 3] = outside[(axis + 2) % 3] = v;
+
+            int a = ChunkIndex(inside[0], inside[1], inside[2]);
+            int b = ChunkIndex(outside[0], outside[1], outside[2]);
+            int levelA = LightLevel(ChunkGetLight(chunk, a), channel);
+            uint8_t lightB = ChunkGetLight(neighbor, b);
+            int levelB = LightLevel(lightB, channel);
+            bool passesA = LightPasses(PackedBlocksGet(&chunk->blocks, a));
+            bool passesB = LightPasses(PackedBlocksGet(&neighbor->blocks, b));
+
+            int ax = ox + inside[0], ay = oy + inside[1], az = oz + inside[2];
+            int bx = ax + lightOffsets[face][0], by = ay + lightOffsets[face][1], bz = az + lightOffsets[face][2];
+
+            if (channel == LIGHT_SKY && face == LIGHT_DOWN && levelB == LIGHT_MAX && levelA != LIGHT_MAX) {
+                ChunkSetLight(neighbor, b, LightWithLevel(lightB, channel, 0));
+                LightMarkBlock(map, engine, bx, by, bz);
+                LightPush(&engine->remove, bx, by, bz, LIGHT_MAX);
+                continue;
+            }
+
+            if (passesA && LightSpreadLevel(levelB, channel, inward) > levelA) LightPush(&engine->add, bx, by, bz, 0);
+            if (passesB && LightSpreadLevel(levelA, channel, face) > levelB) LightPush(&engine->add, ax, ay, az, 0);
+        }
+    }
+}
+
+// Fills in the light of a chunk just added to the map, and carries light across the faces it shares
+// with loaded neighbors both ways. The chunk's occupancy has to be built already.
+void LightChunk(LightEngine *engine, const ChunkMap *map, Chunk *chunk) {
+    PROFILE_ZONE("LightChunk");
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        ChunkFillLight(chunk, s, 0);
+    }
+
+    int ox = chunk->cx * CHUNK_SIZE, oy = chunk->cy * CHUNK_SIZE, oz = chunk->cz * CHUNK_SIZE;
+    const Chunk *above = FindChunk(map, chunk->cx, chunk->cy + 1, chunk->cz);
+
+    // Sky light falls down each column from the chunk above, or from open sky when it is not loaded.
+    // Rows are walked top down until every column has stopped, lowest[z][x] is the lowest block
+    // reached, CHUNK_SIZE when none.
+    int lowest[CHUNK_SIZE][CHUNK_SIZE];
+    bool falling[CHUNK_SIZE][CHUNK_SIZE];
+    int fallingCount = 0;
+    for (int z = 0; z < CHUNK_SIZE; z++) {
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            lowest[z][x] = CHUNK_SIZE;
+            falling[z][x] = above == NULL || LightLevel(ChunkGetLight(above, ChunkIndex(x, 0, z)), LIGHT_SKY) == LIGHT_MAX;
+            fallingCount += falling[z][x];
+        }
+    }
+
+    // Open air under open sky is common above the terrain and all lit the same
+    bool air = chunk->blocks.paletteCount == 1 && chunk->blocks.palette[0] == 0;
+    if (air && fallingCount == CHUNK_SIZE * CHUNK_SIZE) {
+        for (int s = 0; s < SECTION_COUNT; s++) {
+            ChunkFillLight(chunk, s, LIGHT_MAX << LIGHT_SKY_SHIFT);
+        }
+        memset(lowest, 0, sizeof(lowest));
+        fallingCount = 0;
+    }
+
+    // Rows are contiguous along x for a section's width, runs in empty sections are not decoded
+    int row[SECTION_SIZE];
+    for (int y = CHUNK_SIZE - 1; y >= 0 && fallingCount > 0; y--) {
+        for (int z = 0; z < CHUNK_SIZE; z++) {
+            for (int x = 0; x < CHUNK_SIZE; x += SECTION_SIZE) {
+                int index = ChunkIndex(x, y, z);
+                bool empty = air || chunk->occupancy[SectionIndex(x >> SECTION_SHIFT, y >> SECTION_SHIFT, z >> SECTION_SHIFT)] == 0;
+                if (!empty) PackedBlocksGetRun(&chunk->blocks, index, SECTION_SIZE, row);
+
+                for (int i = 0; i < SECTION_SIZE; i++) {
+                    if (!falling[z][x + i]) continue;
+                    if (!empty && !LightPasses(row[i])) {
+                        falling[z][x + i] = false;
+                        fallingCount--;
+                        continue;
+                    }
+                    lowest[z][x + i] = y;
+                    ChunkSetLight(chunk, index + i, LIGHT_MAX << LIGHT_SKY_SHIFT);
+                }
+            }
+        }
+    }
+
+    // Lit blocks spread sideways only where the neighbor column stops higher up
+    for (int z = 0; z < CHUNK_SIZE; z++) {
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            for (int i = 0; i < 6; i++) {
+                int nx = x + lightOffsets[i][0], nz = z + lightOffsets[i][2];
+                if (lightOffsets[i][1] != 0 || nx < 0 || nz < 0 || nx == CHUNK_SIZE || nz == CHUNK_SIZE) continue;
+                for (int y = lowest[z][x]; y < lowest[nz][nx]; y++) {
+                    LightPush(&engine->add, ox + x, oy + y, oz + z, 0);
+                }
+            }
+        }
+    }
+
+    for (int face = 0; face < 6; face++) {
+        LightChunkFace(engine, map, chunk, face, LIGHT_SKY);
+    }
+    LightUnflood(engine, map, LIGHT_SKY);
+    LightFlood(engine, map, LIGHT_SKY);
+
+    // Most chunks have no glowing ids in their palette at all
+    bool glows = false;
+    for (int i = 0; i < chunk->blocks.paletteCount; i++) {
+        if (BlockEmission(chunk->blocks.palette[i]) > 0) glows = true;
+    }
+
+    if (glows) {
+        int row[CHUNK_SIZE];
+        for (int i = 0; i < CHUNK_VOLUME; i += CHUNK_SIZE) {
+            PackedBlocksGetRun(&chunk->blocks, i, CHUNK_SIZE, row);
+            for (int j = 0; j < CHUNK_SIZE; j++) {
+                int emission = BlockEmission(row[j]);
+                if (emission == 0) continue;
+
+                int x, y, z;
+                ChunkPosition(i + j, &x, &y, &z);
+                ChunkSetLight(chunk, i + j, LightWithLevel(ChunkGetLight(chunk, i + j), LIGHT_BLOCK, emission));
+                LightPush(&engine->add, ox + x, oy + y, oz + z, 0);
+            }
+        }
+    }
+
+    for (int face = 0; face < 6; face++) {
+        LightChunkFace(engine, map, chunk, face, LIGHT_BLOCK);
+    }
+    LightFlood(engine, map, LIGHT_BLOCK);
+
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        ChunkCompactLight(chunk, s);
+    }
+}
+
+// Empties the list of relit sections once the caller has remeshed them, dropping the light arrays
+// of those that ended up lit all the same
+void LightClearSections(LightEngine *engine, const ChunkMap *map) {
+    int mask = SECTIONS_PER_AXIS - 1;
+    for (int i = 0; i < engine->sectionCount; i++) {
+        int *section = engine->sections[i];
+        Chunk *chunk = FindChunk(map, section[0] >> CHUNK_SECTION_SHIFT, section[1] >> CHUNK_SECTION_SHIFT, section[2] >> CHUNK_SECTION_SHIFT);
+        if (chunk == NULL) continue;
+
+        chunk->relit = 0;
+        ChunkCompactLight(chunk, SectionIndex(section[0] & mask, section[1] & mask, section[2] & mask));
+    }
+    engine->sectionCount = 0;
+}
+
+void LightEngineFree(LightEngine *engine) {
+    free(engine->add.nodes);
+    free(engine->remove.nodes);
+    free(engine->sections);
+    *engine = (LightEngine){ 0 };
+}
\ No newline at end of file
@@ -1,15 +1,84 @@
 #include "raylib.h"
 #include "raymath.h"
-#include "array.h"
+#include "rlgl.h"
+#include "profiler.h"
+
+#include "cpu.h"
+#include "arena.h"
+#include "sprites.h"
+#include "palette.h"
+#include "world.h"
+#include "light.h"
 #include "dda.h"
+#include "collision.h"
+#include "player.h"
+#include "timestep.h"
+#include "codec.h"
+#include "mapfile.h"
+#include "crc32c.h"
+#include "region.h"
+#include "mesher.h"
+#include "thread.h"
+#include "remesh.h"
+#include "save.h"
+#include "journal.h"
+#include "frustum.h"
 
 const int screenWidth = 1280;
 const int screenHeight = 720;
 
-#define CHUNK_SIZE 64
-int world[CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE] = { 0 };
+// Chunks are loaded within LOAD_RADIUS of the player's chunk on every axis, and unloaded once
+// further than UNLOAD_RADIUS, so walking along a chunk border does not reload the same chunks
+#define LOAD_RADIUS 1
+#define UNLOAD_RADIUS 2
 
-Mesh worldMesh = { 0 };
+ChunkMap chunks = { 0 };
+
+// Matches layout(location = 0) of the packed vertex attribute in vertex.glsl
+#define VERTEX_DATA_LOCATION 0
+
+typedef struct {
+    unsigned int vaoId;
+    unsigned int vboId;
+    int quadCount;
+} QuadBuffer;
+
+typedef struct {
+    QuadBuffer blocks;
+    QuadBuffer sprites;
+    unsigned int version;    // Version of the uploaded mesh
+    unsigned int submitted;  // Version of the last snapshot sent to the workers
+    RemeshJob *queued;
+} SectionMesh;
+
+struct ChunkRender {
+    SectionMesh sections[SECTION_COUNT];
+};
+
+// A non-empty section of a loaded chunk, gathered each frame for culling
+typedef struct {
+    SectionMesh *mesh;
+    Vector3 origin;
+} SectionDraw;
+
+unsigned int quadIndexBuffer = 0;
+int sectionOriginLoc = -1;
+int atlasTilesLoc = -1;
+BoxList sectionBoxes = { 0 };
+SectionDraw *sectionDraws = NULL;
+unsigned char *sectionVisible = NULL;
+CullStats cullStats = { 0 };
+RemeshQueue remeshQueue;
+SaveQueue saveQueue;
+Journal journal;
+LightEngine lighting = { 0 };
+
+// Simulation clock, its tick count is stamped on journaled edits
+FixedTimestep timestep;
+
+// Seconds between background saves of changed chunks
+#define AUTOSAVE_INTERVAL 60.0f
+float autosaveTimer = 0.0f;
 Camera camera = { (Vector3){ 10.0f, 10.0f, 30.0f }, (Vector3){ CHUNK_SIZE / 2, 5.0f, CHUNK_SIZE / 2 }, (Vector3){ 0.0f, 1.0f, 0.0f }, 60.0f, CAMERA_PERSPECTIVE };
 
 int currentBlock = 1;
@@ -19,34 +88,44 @@ const int textureSize = 16;
 const int scale = 2;
 const int scaledTextureSize = textureSize * scale;
 
-void ReloadMesh();
+void LoadQuadIndexBuffer();
+void DrawSections(Material material, Texture2D spriteTexture);
+void LoadChunk(int cx, int cy, int cz);
+void UnloadChunk(Chunk *chunk, bool save);
+void UpdateLoadedChunks(int maxLoads);
+void ReloadChunk(const Chunk *chunk);
+void UnloadQuadBuffer(QuadBuffer *buffer);
+void UploadFinishedSections();
+void ReloadSection(int sx, int sy, int sz);
+void ReloadBlock(int x, int y, int z);
+void ReloadLitSections();
+bool EditBlock(int x, int y, int z, int id);
+void ReplayJournal();
 void PlaceBreakBlock(Model model);
 void SaveWorld();
 void LoadWorld();
 void DrawTextureMenu(Texture2D textureAtlas);
-float SignedDistanceFunction(Vector3 point);
-void UpdatePlayer(float deltaTime);
+void ReadPlayerInput(PlayerInput *input);
+void UpdatePlayerCamera(float alpha);
 void UpdateHotbarSelection();
 void DrawHotbar(Texture texture, Texture other);
 
-typedef struct {
-    Vector3 position;
-    Vector3 velocity;
-    float yaw;
-    float pitch;
-} Player;
-
 Player player = { 0 };
-const float GRAVITY = -9.8f;
-const float JUMP_FORCE = 6.0f;
-const float PLAYER_SPEED = 8.0f;
 const float MOUSE_SENSITIVITY = 0.003f;
-const float PLAYER_RADIUS = 0.3f;
 
-int breakingID = -1;
+// Input read since the last tick, a jump pressed between two ticks waits for the next one
+PlayerInput playerInput = { 0 };
+// Where the player was one tick ago, the camera blends it with the current position
+Vector3 previousPlayerPosition = { 0 };
+
+bool breaking = false;
+int breakingX = 0, breakingY = 0, breakingZ = 0;
 float breakingTime = 0.0f;
 Texture2D animations[10] = {0};
 
+// Blocks can be broken and placed this far from the camera
+#define REACH_DISTANCE 8.0f
+
 #define HOTBAR_SIZE 9
 
 int hotbar[HOTBAR_SIZE] = { 1, 2, 3, 4, -5, -4, -3, -2, -1 };
@@ -57,10 +136,26 @@ int main() {
     InitWindow(screenWidth, screenHeight, "freakyKraft 2");
     DisableCursor();
 
+    player.position = (Vector3){ 16, 10.0f, CHUNK_SIZE / 2.0f };
+    player.velocity = (Vector3){ 0.0f, 0.0f, 0.0f };
+    player.yaw = 0.0f;
+    player.pitch = 0.0f;
+    previousPlayerPosition = player.position;
+
+    ProfileThreadName("Main");
+    LoadQuadIndexBuffer();
+    FixedTimestepInit(&timestep, SIMULATION_HZ);
+    CpuInit();
+    Crc32cInit();
+    ChunkMapInit(&chunks, 64);
+    RemeshQueueInit(&remeshQueue);
+    SaveQueueInit(&saveQueue);
+    JournalInit(&journal);
     LoadWorld();
-    ReloadMesh();
     Shader shader = LoadShader("shaders/vertex.glsl","shaders/fragment.glsl");
     shader.locs[SHADER_LOC_VECTOR_VIEW] = GetShaderLocation(shader, "viewPos");
+    sectionOriginLoc = GetShaderLocation(shader, "sectionOrigin");
+    atlasTilesLoc = GetShaderLocation(shader, "atlasTiles");
     Texture2D texture = LoadTexture("atlas.png");
     Material material = LoadMaterialDefault();
     material.maps[MATERIAL_MAP_DIFFUSE].texture = texture;
@@ -77,16 +172,29 @@ int main() {
         animations[i] = LoadTextureFromImage(imgCpy);
     }
 
-    player.position = (Vector3){ 16, 10.0f, CHUNK_SIZE / 2.0f };
-    player.velocity = (Vector3){ 0.0f, 0.0f, 0.0f };
-    player.yaw = 0.0f;
-    player.pitch = 0.0f;
-
     while (!WindowShouldClose()) {
         float deltaTime = GetFrameTime();
+        ProfileFrame();
 
-        if (IsKeyPressed(KEY_N)) {
+        if (IsKeyPressed(KEY_F3)) ProfilerSetEnabled(!profiler.enabled);
+        if (IsKeyPressed(KEY_F4)) {
+            if (ProfilerDumpTrace("trace.json")) printf("Profile written to trace.json\n");
+            else printf("Failed to write trace.json\n");
+        }
+
+        autosaveTimer += deltaTime;
+        if (IsKeyPressed(KEY_N) || autosaveTimer >= AUTOSAVE_INTERVAL) {
             SaveWorld();
+            autosaveTimer = 0.0f;
+        }
+
+        {
+            PROFILE_ZONE("SaveQueuePoll");
+            if (SaveQueuePoll(&saveQueue, &chunks) > 0) {
+                printf("Failed to save world, changes are kept for the next save\n");
+                journal.saveFailed = true;
+            }
+            if (SaveQueueIdle(&saveQueue)) JournalSavesFinished(&journal);
         }
 
         if (IsKeyPressed(KEY_M)) {
@@ -100,38 +208,41 @@ int main() {
         }
 
         if (!isMenuOpen) {
-            UpdatePlayer(deltaTime);
+            ReadPlayerInput(&playerInput);
         }
 
+        // Physics runs at SIMULATION_HZ whatever the frame rate, and the camera is drawn between
+        // the last two ticks. The player stays put while the menu is open.
+        {
+            PROFILE_ZONE("Simulate");
+            int steps = FixedTimestepAdvance(&timestep, deltaTime);
+            for (int i = 0; i < steps; i++) {
+                previousPlayerPosition = player.position;
+                if (!isMenuOpen) SimulatePlayer(&player, &chunks, playerInput, (float)timestep.step);
+                playerInput.jump = false;
+            }
+        }
+        UpdatePlayerCamera(FixedTimestepAlpha(&timestep));
+
+        UpdateLoadedChunks(1);
+
+        UploadFinishedSections();
+
         SetShaderValue(shader, shader.locs[SHADER_LOC_VECTOR_VIEW], &camera.position.x, SHADER_UNIFORM_VEC3);
 
         BeginDrawing();
         ClearBackground((Color){ 64, 180, 255 , 255});
         BeginMode3D(camera);
-        DrawMesh(worldMesh, material, MatrixIdentity());
+        DrawSections(material, otherTexture);
 
         if(!isMenuOpen) {
             PlaceBreakBlock(model);
         }
 
-        for (int x = 0; x < CHUNK_SIZE; x++) {
-            for (int y = 0; y < CHUNK_SIZE; y++) {
-                for (int z = 0; z < CHUNK_SIZE; z++) {
-                    int id = x + y * CHUNK_SIZE + z * CHUNK_SIZE * CHUNK_SIZE;
-                    int blockId = world[id] - 1;
-                    if(blockId >= -1) continue;
-
-                    int texX = (blockId % 8) * textureSize;
-                    int texY = (blockId / 8) * textureSize;
-                    Rectangle source = { texX, texY, textureSize, textureSize };
-
-                    DrawBillboardPro(camera, otherTexture, source, (Vector3){x + 0.5, y + 0.5, z + 0.5},  (Vector3){0, 1, 0}, (Vector2){1, 1}, (Vector2){0.5, 0.5}, 0, WHITE);
-                }
-            }
-        }
-
         EndMode3D();
         DrawFPS(1195, 5);
+        DrawText(TextFormat("%d/%d sections", cullStats.drawn, cullStats.tested), 1130, 25, 20, WHITE);
+        ProfilerDrawOverlay(screenWidth - PROFILE_FRAMES * 2 - 10, 55);
         DrawLineEx((Vector2){screenWidth / 2 - 10, screenHeight / 2}, (Vector2){screenWidth / 2 + 10, screenHeight / 2}, 2, WHITE);
         DrawLineEx((Vector2){screenWidth / 2, screenHeight / 2 - 10}, (Vector2){screenWidth / 2, screenHeight / 2 + 10}, 2, WHITE);
 
@@ -142,9 +253,19 @@ int main() {
             DrawHotbar(texture, otherTexture);
         }
 
+        // Includes waiting for vsync
+        PROFILE_ZONE("EndDrawing");
         EndDrawing();
     }
 
+    RemeshQueueShutdown(&remeshQueue);
+    SaveQueueShutdown(&saveQueue, &chunks);
+    JournalShutdown(&journal);
+    LightEngineFree(&lighting);
+    BoxListFree(&sectionBoxes);
+    free(sectionDraws);
+    free(sectionVisible);
+    UnmapAllRegions();
     CloseWindow();
 }
 
@@ -158,6 +279,7 @@ void UpdateHotbarSelection() {
 }
 
 void DrawHotbar(Texture texture, Texture other) {
+    PROFILE_ZONE("DrawHotbar");
     int hotbarWidth = HOTBAR_SIZE * 70 + 15;
     int hotbarHeight = 80;
     int xPos = (screenWidth - hotbarWidth) / 2;
@@ -184,106 +306,27 @@ void DrawHotbar(Texture texture, Texture other) {
     }
 }
 
-float SignedDistanceFunction(Vector3 point) {
-    float minDistance = INFINITY;
-
-    int x0 = (int)floorf(point.x);
-    int y0 = (int)floorf(point.y);
-    int z0 = (int)floorf(point.z);
-
-    for (int dx = -1; dx <= 1; dx++) {
-        for (int dy = -1; dy <= 1; dy++) {
-            for (int dz = -1; dz <= 1; dz++) {
-                int x = x0 + dx;
-                int y = y0 + dy;
-                int z = z0 + dz;
-
-                if (x >= 0 && x < CHUNK_SIZE && y >= 0 && y < CHUNK_SIZE && z >= 0 && z < CHUNK_SIZE) {
-                    if (world[x + y * CHUNK_SIZE + z * CHUNK_SIZE * CHUNK_SIZE] > 0) {
-                        Vector3 closest = {
-                            fmaxf(x, fminf(point.x, x + 1)),
-                            fmaxf(y, fminf(point.y, y + 1)),
-                            fmaxf(z, fminf(point.z, z + 1))
-                        };
-                        float distance = Vector3Distance(point, closest);
-                        minDistance = fminf(minDistance, distance);
-                    }
-                }
-            }
-        }
-    }
-
-    return minDistance;
-}
-
-void UpdatePlayer(float deltaTime) {
-    player.velocity.y += GRAVITY * deltaTime;
-
-    Vector3 moveDirection = { 0 };
-    if (IsKeyDown(KEY_W)) moveDirection.z += 1.0f;
-    if (IsKeyDown(KEY_S)) moveDirection.z -= 1.0f;
-    if (IsKeyDown(KEY_A)) moveDirection.x -= 1.0f;
-    if (IsKeyDown(KEY_D)) moveDirection.x += 1.0f;
-
-    Vector3 forward = { cosf(player.yaw), 0, sinf(player.yaw) };
-    Vector3 right = { -sinf(player.yaw), 0, cosf(player.yaw) };
-
-    Vector3 movement = Vector3Add(
-        Vector3Scale(forward, moveDirection.z),
-        Vector3Scale(right, moveDirection.x)
-    );
-
-    movement.y = 0;
-    if(Vector3Length(movement) > 0) {
-        movement = Vector3Scale(Vector3Normalize(movement), PLAYER_SPEED * deltaTime);
-    }
-
-    if (IsKeyPressed(KEY_SPACE) && SignedDistanceFunction((Vector3){player.position.x, player.position.y - PLAYER_RADIUS, player.position.z}) < 0.01f) {
-        player.velocity.y = JUMP_FORCE;
-    }
-
-    player.position = Vector3Add(player.position, (Vector3){movement.x, 0, movement.z});
-    float distance = SignedDistanceFunction(player.position);
-
-    if (distance < PLAYER_RADIUS) {
-        Vector3 normal = {
-            SignedDistanceFunction((Vector3){player.position.x + 0.01f, player.position.y, player.position.z}) - distance,
-            0,
-            SignedDistanceFunction((Vector3){player.position.x, player.position.y, player.position.z + 0.01f}) - distance
-        };
-
-        normal = Vector3Normalize(normal);
-        player.position = Vector3Add(player.position, Vector3Scale(normal, PLAYER_RADIUS - distance));
-    }
-
-    float oldY = player.position.y;
-    player.position.y += player.velocity.y * deltaTime;
-    distance = SignedDistanceFunction((Vector3){player.position.x, player.position.y - 0.1f, player.position.z});
-
-    if (distance < 0.2f) {
-        if (player.velocity.y < 0) {
-            player.position.y = oldY;
-            player.velocity.y = 0;
-        } else {
-            player.position.y = player.position.y + (0.2f - distance);
-            player.velocity.y = 0;
-        }
-    }
-
-    distance = SignedDistanceFunction((Vector3){player.position.x, player.position.y + 1.4f, player.position.z});
-
-    if (distance < 0.2f) {
-        if (player.velocity.y > 0) {
-            player.velocity.y = 0;
-        }
-    }
+void ReadPlayerInput(PlayerInput *input) {
+    input->forward = 0;
+    input->right = 0;
+    if (IsKeyDown(KEY_W)) input->forward += 1.0f;
+    if (IsKeyDown(KEY_S)) input->forward -= 1.0f;
+    if (IsKeyDown(KEY_A)) input->right -= 1.0f;
+    if (IsKeyDown(KEY_D)) input->right += 1.0f;
+    if (IsKeyPressed(KEY_SPACE)) input->jump = true;
 
+    // Looking around follows the mouse every frame, not every tick
     Vector2 mouseDelta = GetMouseDelta();
     player.yaw += mouseDelta.x * MOUSE_SENSITIVITY;
     player.pitch -= mouseDelta.y * MOUSE_SENSITIVITY;
     player.pitch = Clamp(player.pitch, -PI/2 + 0.01f, PI/2 - 0.01f);
+    input->yaw = player.yaw;
+}
 
-    camera.position = Vector3Add(player.position, (Vector3){ 0, 1.4f, 0 });
+// Places the camera at the player's eyes, alpha of the way from the previous tick to the last one
+void UpdatePlayerCamera(float alpha) {
+    Vector3 position = Vector3Lerp(previousPlayerPosition, player.position, alpha);
+    camera.position = Vector3Add(position, (Vector3){ 0, PLAYER_EYE_HEIGHT, 0 });
     camera.target = Vector3Add(camera.position, (Vector3){
         cosf(player.yaw) * cosf(player.pitch),
         sinf(player.pitch),
@@ -292,6 +335,7 @@ void UpdatePlayer(float deltaTime) {
 }
 
 void DrawTextureMenu(Texture2D textureAtlas) {
+    PROFILE_ZONE("DrawTextureMenu");
     int atlasCols = textureAtlas.width / textureSize;
     int atlasRows = textureAtlas.height / textureSize;
     int startX = (screenWidth - textureGridSize * scaledTextureSize) / 2;
@@ -325,234 +369,455 @@ void DrawTextureMenu(Texture2D textureAtlas) {
 }
 
 void PlaceBreakBlock(Model model) {
-    DDACursor cursor = DDACursorCreate(camera.position, Vector3Normalize(Vector3Subtract(camera.target, camera.position)));
-
-    int i = 0;
-    for (i = 0; i < 12; i++) {
-        Vector3 mapPos = DDACursorStep(&cursor);
-
-        int blockX = (int)floor(mapPos.x);
-        int blockY = (int)floor(mapPos.y);
-        int blockZ = (int)floor(mapPos.z);
-        int blockID = blockX + blockY * CHUNK_SIZE + blockZ * CHUNK_SIZE * CHUNK_SIZE;
-
-        if (blockX >= 0 && blockX < CHUNK_SIZE && blockY >= 0 && blockY < CHUNK_SIZE && blockZ >= 0 && blockZ < CHUNK_SIZE) {
-            if(world[blockID] != 0) {
-                if(IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
-                    if(breakingID != blockID) {
-                        breakingID = blockID;
-                        breakingTime = 0.0f;
-                    } else if(breakingTime < 1.0f) {
-                        breakingTime += GetFrameTime();
-                         model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = animations[(int)(breakingTime * 10) % 10];
-                        DrawModel(model, (Vector3) {blockX + 0.5f, blockY + 0.5f, blockZ + 0.5f}, 1, WHITE);
-                    } else {
-                        world[blockID] = 0;
-                        breakingID = -1;
-                        breakingTime = 0.0f;
-                        ReloadMesh();
-                    }
-                } else if(IsMouseButtonPressed(MOUSE_MIDDLE_BUTTON)) {
-                    currentBlock = world[blockID];
-                    hotbar[selectedHotbarIndex] = currentBlock;
-                } else if(IsMouseButtonPressed(MOUSE_RIGHT_BUTTON) || (IsMouseButtonDown(MOUSE_RIGHT_BUTTON) && IsKeyDown(KEY_LEFT_SHIFT))) {
-                    Vector3 normal = DDACursorGetNormal(&cursor);
-
-                    int newBlockX = (int)floor(mapPos.x + normal.x);
-                    int newBlockY = (int)floor(mapPos.y + normal.y);
-                    int newBlockZ = (int)floor(mapPos.z + normal.z);
-                    int newBlockID = newBlockX + newBlockY * CHUNK_SIZE + newBlockZ * CHUNK_SIZE * CHUNK_SIZE;
-
-                    int x = (int)floorf(player.position.x);
-                    int y = (int)floorf(player.position.y);
-                    int z = (int)floorf(player.position.z);
-                    int playerBlockID = x + y * CHUNK_SIZE + z * CHUNK_SIZE * CHUNK_SIZE;
-
-                    if (playerBlockID != newBlockID && playerBlockID - CHUNK_SIZE != newBlockID && newBlockX >= 0 && newBlockX < CHUNK_SIZE && newBlockY >= 0 && newBlockY < CHUNK_SIZE && newBlockZ >= 0 && newBlockZ < CHUNK_SIZE) {
-                        world[newBlockID] = currentBlock;
-                        ReloadMesh();
-                    }
-                }
-                DrawCubeWires((Vector3) {blockX + 0.5f, blockY + 0.5f, blockZ + 0.5f}, 1.02f, 1.02f, 1.02f, WHITE);
-                break;
+    PROFILE_ZONE("PlaceBreakBlock");
+    DDAHit hit = DDACast(&chunks, camera.position, Vector3Subtract(camera.target, camera.position), REACH_DISTANCE);
+
+    if (hit.hit) {
+        int blockX = hit.x;
+        int blockY = hit.y;
+        int blockZ = hit.z;
+
+        if(IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
+            if(!breaking || breakingX != blockX || breakingY != blockY || breakingZ != blockZ) {
+                breaking = true;
+                breakingX = blockX;
+                breakingY = blockY;
+                breakingZ = blockZ;
+                breakingTime = 0.0f;
+            } else if(breakingTime < 1.0f) {
+                breakingTime += GetFrameTime();
+                 model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = animations[(int)(breakingTime * 10) % 10];
+                DrawModel(model, (Vector3) {blockX + 0.5f, blockY + 0.5f, blockZ + 0.5f}, 1, WHITE);
+            } else {
+                EditBlock(blockX, blockY, blockZ, 0);
+                breaking = false;
+                breakingTime = 0.0f;
+            }
+        } else if(IsMouseButtonPressed(MOUSE_MIDDLE_BUTTON)) {
+            currentBlock = hit.block;
+            hotbar[selectedHotbarIndex] = currentBlock;
+        } else if(IsMouseButtonPressed(MOUSE_RIGHT_BUTTON) || (IsMouseButtonDown(MOUSE_RIGHT_BUTTON) && IsKeyDown(KEY_LEFT_SHIFT))) {
+            int newBlockX = blockX + (int)hit.normal.x;
+            int newBlockY = blockY + (int)hit.normal.y;
+            int newBlockZ = blockZ + (int)hit.normal.z;
+
+            if (!BoxOverlapsBlock(PlayerBox(player.position), newBlockX, newBlockY, newBlockZ)) {
+                EditBlock(newBlockX, newBlockY, newBlockZ, currentBlock);
             }
         }
+        DrawCubeWires((Vector3) {blockX + 0.5f, blockY + 0.5f, blockZ + 0.5f}, 1.02f, 1.02f, 1.02f, WHITE);
     }
 
-    if(IsMouseButtonUp(MOUSE_LEFT_BUTTON) || i == 8) {
-        breakingID = -1;
+    if(IsMouseButtonUp(MOUSE_LEFT_BUTTON) || !hit.hit) {
+        breaking = false;
         breakingTime = 0.0f;
     }
 }
 
+// Changes a block the player edited, journaling it before anything else sees it.
+// Returns false when the block's chunk is not loaded.
+bool EditBlock(int x, int y, int z, int id) {
+    int oldId = GetBlock(&chunks, x, y, z);
+    if (!SetBlock(&chunks, x, y, z, id)) return false;
+
+    JournalAppend(&journal, x, y, z, oldId, id, (unsigned int)timestep.ticks);
+    LightUpdateBlock(&lighting, &chunks, x, y, z, oldId, id);
+    ReloadBlock(x, y, z);
+    ReloadLitSections();
+    return true;
+}
+
+// Queues a background save of every region with a loaded chunk that changed since it was loaded or
+// last saved. Queueing a region clears the dirty flag of all its loaded chunks, so each region is
+// queued once. The save is also a journal checkpoint, the edits journaled so far are dropped once
+// it is written.
 void SaveWorld() {
-    FILE *file = fopen("world", "wb");
-    if (file == NULL) {
-        printf("Failed to save world\n");
-        return;
+    PROFILE_ZONE("SaveWorld");
+    JournalCheckpoint(&journal);
+    for (int i = 0; i < chunks.capacity; i++) {
+        Chunk *chunk = chunks.slots[i].chunk;
+        if (chunk != NULL && chunk->dirty) SaveQueueSubmit(&saveQueue, &chunks, chunk->cx, chunk->cy, chunk->cz);
     }
-
-    fwrite(world, sizeof(int), CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE, file);
-    fclose(file);
 }
 
+// Unloads every chunk, queueing the changed ones for saving like streaming does, and loads the
+// player's chunk again, then replays the journal over it. Chunks whose save is still in flight load
+// from the save queue, so nothing unsaved is lost. The chunks around the player stream in over the
+// next frames, so the first frame is not held up.
 void LoadWorld() {
-    FILE *file = fopen("world", "rb");
-    if (file == NULL) {
-        for (int x = 0; x < CHUNK_SIZE; x++) {
-            for (int z = 0; z < CHUNK_SIZE; z++) {
-                for (int y = 0; y < 4; y++) {
-                    world[x * CHUNK_SIZE * CHUNK_SIZE + y * CHUNK_SIZE + z] = 2;
-                }
-                world[x * CHUNK_SIZE * CHUNK_SIZE + 4 * CHUNK_SIZE + z] = 3;
-                world[x * CHUNK_SIZE * CHUNK_SIZE + 5 * CHUNK_SIZE + z] = 1;
+    PROFILE_ZONE("LoadWorld");
+    while (chunks.count > 0) {
+        for (int i = 0; i < chunks.capacity; i++) {
+            if (chunks.slots[i].chunk != NULL) {
+                UnloadChunk(chunks.slots[i].chunk, true);
+                break;
             }
         }
     }
 
-    fread(world, sizeof(int), CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE, file);
-    fclose(file);
+    UpdateLoadedChunks(1);
+    ReplayJournal();
     printf("World loaded successfully\n");
-    ReloadMesh();
 }
 
-void ReloadMesh() {
-    float vertices[] = {
-        0, 0, 1,
-        1, 0, 1,
-        1, 1, 1,
-        0, 1, 1,
-        0, 0, 0,
-        0, 1, 0,
-        1, 1, 0,
-        1, 0, 0,
-        0, 1, 0,
-        0, 1, 1,
-        1, 1, 1,
-        1, 1, 0,
-        0, 0, 0,
-        1, 0, 0,
-        1, 0, 1,
-        0, 0, 1,
-        1, 0, 0,
-        1, 1, 0,
-        1, 1, 1,
-        1, 0, 1,
-        0, 0, 0,
-        0, 0, 1,
-        0, 1, 1,
-        0, 1, 0
-    };
-
-    float texcoords[] = {
-        1.0f, 1.0f,
-        0.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 0.0f,
-        0.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 0.0f,
-        1.0f, 1.0f,
-        0.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 0.0f,
-        1.0f, 1.0f,
-        1.0f, 1.0f,
-        0.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 0.0f,
-        0.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 0.0f,
-        1.0f, 1.0f,
-        1.0f, 1.0f,
-        0.0f, 1.0f,
-        0.0f, 0.0f,
-        1.0f, 0.0f
-    };
-
-    float normals[] = {
-        0.0f, 0.0f, 1.0f,
-        0.0f, 0.0f, 1.0f,
-        0.0f, 0.0f, 1.0f,
-        0.0f, 0.0f, 1.0f,
-        0.0f, 0.0f,-1.0f,
-        0.0f, 0.0f,-1.0f,
-        0.0f, 0.0f,-1.0f,
-        0.0f, 0.0f,-1.0f,
-        0.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-        0.0f,-1.0f, 0.0f,
-        0.0f,-1.0f, 0.0f,
-        0.0f,-1.0f, 0.0f,
-        0.0f,-1.0f, 0.0f,
-        1.0f, 0.0f, 0.0f,
-        1.0f, 0.0f, 0.0f,
-        1.0f, 0.0f, 0.0f,
-        1.0f, 0.0f, 0.0f,
-        -1.0f, 0.0f, 0.0f,
-        -1.0f, 0.0f, 0.0f,
-        -1.0f, 0.0f, 0.0f,
-        -1.0f, 0.0f, 0.0f
-    };
-
-    Array vert = newArray(32 * 32);
-    Array tex = newArray(32 * 32);
-    Array norm = newArray(32 * 32);
-
-    for (int x = 0; x < CHUNK_SIZE; x++) {
-        for (int y = 0; y < CHUNK_SIZE; y++) {
-            for (int z = 0; z < CHUNK_SIZE; z++) {
-                int id = x + y * CHUNK_SIZE + z * CHUNK_SIZE * CHUNK_SIZE;
-                if(world[id] <= 0) continue;
-
-                for (int i = 0; i < 24; i++) {
-                    if(15 < i && i < 20 && x < (CHUNK_SIZE - 1) && world[id + 1] > 0) continue;
-                    if(19 < i && i < 24 && x > 0 && world[id - 1] > 0) continue;
-                    if(7 < i  && i < 12 && y < (CHUNK_SIZE - 1) && world[id + CHUNK_SIZE] > 0) continue;
-                    if(11 < i && i < 16 && y > 0 && world[id - CHUNK_SIZE] > 0) continue;
-                    if(i < 4  && z < (CHUNK_SIZE - 1) && world[id + CHUNK_SIZE * CHUNK_SIZE] > 0) continue;
-                    if(3 < i  && i < 8  && z > 0 && world[id - CHUNK_SIZE * CHUNK_SIZE] > 0) continue;
-
-                    push(&vert, vertices[i * 3 + 0] + x);
-                    push(&vert, vertices[i * 3 + 1] + y);
-                    push(&vert, vertices[i * 3 + 2] + z);
-
-                    int type = world[id] - 1;
-                    push(&tex, texcoords[i * 2 + 0] * (1.0f / 16) + (type % 16) * (1.0f / 16));
-                    push(&tex, texcoords[i * 2 + 1] * (1.0f / 16) + (type / 16) * (1.0f / 16));
-
-                    push(&norm, normals[i * 3 + 0]);
-                    push(&norm, normals[i * 3 + 1]);
-                    push(&norm, normals[i * 3 + 2]);
+// Applies the journaled edits in order, loading the chunks they touch. Edits a save already holds
+// apply again harmlessly, since the last write to a block wins either way. The replayed chunks are
+// saved in the background right away so the journal can be dropped.
+void ReplayJournal() {
+    PROFILE_ZONE("ReplayJournal");
+    JournalFlush(&journal);
+
+    int count;
+    JournalRecord *records = JournalRead(&count);
+
+    for (int i = 0; i < count; i++) {
+        JournalRecord *record = &records[i];
+        int cx = record->x >> CHUNK_SHIFT;
+        int cy = record->y >> CHUNK_SHIFT;
+        int cz = record->z >> CHUNK_SHIFT;
+
+        if (FindChunk(&chunks, cx, cy, cz) == NULL) LoadChunk(cx, cy, cz);
+        int oldId = GetBlock(&chunks, record->x, record->y, record->z);
+        SetBlock(&chunks, record->x, record->y, record->z, record->newId);
+        LightUpdateBlock(&lighting, &chunks, record->x, record->y, record->z, oldId, record->newId);
+        ReloadBlock(record->x, record->y, record->z);
+        ReloadLitSections();
+    }
+    free(records);
+
+    if (count > 0) {
+        printf("Replayed %d journaled edits\n", count);
+        SaveWorld();
+    }
+}
+
+// Takes the chunk from a save still in flight, its region file, or generates it when it was never saved
+void LoadChunk(int cx, int cy, int cz) {
+    PROFILE_ZONE("LoadChunk");
+    Chunk *chunk = NewChunk(&chunks, cx, cy, cz);
+    bool mapped = !SaveQueueRegionPending(&saveQueue, cx >> REGION_SHIFT, cy >> REGION_SHIFT, cz >> REGION_SHIFT);
+
+    if (!SaveQueueFind(&saveQueue, cx, cy, cz, &chunk->blocks) && !LoadChunkFile(chunk, mapped)) {
+        GenerateChunk(chunk);
+    }
+    RebuildChunkSprites(chunk);
+    RebuildChunkOccupancy(chunk);
+
+    chunk->render = (struct ChunkRender *)calloc(1, sizeof(struct ChunkRender));
+    ChunkMapInsert(&chunks, chunk);
+    LightChunk(&lighting, &chunks, chunk);
+    ReloadChunk(chunk);
+    ReloadLitSections();
+}
+
+void UnloadChunk(Chunk *chunk, bool save) {
+    PROFILE_ZONE("UnloadChunk");
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        SectionMesh *section = &chunk->render->sections[i];
+        RemeshQueueCancel(&remeshQueue, &section->queued);
+        UnloadQuadBuffer(&section->blocks);
+        UnloadQuadBuffer(&section->sprites);
+    }
+
+    if (save && chunk->dirty) SaveQueueSubmit(&saveQueue, &chunks, chunk->cx, chunk->cy, chunk->cz);
+
+    ChunkMapRemove(&chunks, chunk->cx, chunk->cy, chunk->cz);
+    free(chunk->render);
+    FreeChunk(chunk);
+}
+
+// Unloads far chunks and loads up to maxLoads missing chunks around the player, nearest first
+void UpdateLoadedChunks(int maxLoads) {
+    PROFILE_ZONE("UpdateLoadedChunks");
+    int pcx = (int)floorf(player.position.x) >> CHUNK_SHIFT;
+    int pcy = (int)floorf(player.position.y) >> CHUNK_SHIFT;
+    int pcz = (int)floorf(player.position.z) >> CHUNK_SHIFT;
+
+    // Removal shifts later entries back into the freed slot, so look at the same slot again
+    for (int i = 0; i < chunks.capacity; i++) {
+        Chunk *chunk = chunks.slots[i].chunk;
+        if (chunk == NULL) continue;
+
+        int distance = abs(chunk->cx - pcx);
+        if (abs(chunk->cy - pcy) > distance) distance = abs(chunk->cy - pcy);
+        if (abs(chunk->cz - pcz) > distance) distance = abs(chunk->cz - pcz);
+
+        if (distance > UNLOAD_RADIUS) {
+            UnloadChunk(chunk, true);
+            i--;
+        }
+    }
+
+    // Each shell loads top down, so the sky light a chunk gets from above is there when it loads
+    // instead of being taken from open sky and taken back when the chunk above comes in
+    int loaded = 0;
+    for (int r = 0; r <= LOAD_RADIUS; r++) {
+        for (int dy = r; dy >= -r; dy--) {
+            for (int dz = -r; dz <= r; dz++) {
+                for (int dx = -r; dx <= r; dx++) {
+                    // Only the shell at distance r, inner shells were handled already
+                    if (abs(dx) != r && abs(dy) != r && abs(dz) != r) continue;
+                    if (ChunkMapGet(&chunks, pcx + dx, pcy + dy, pcz + dz) != NULL) continue;
+                    if (loaded == maxLoads) return;
+
+                    LoadChunk(pcx + dx, pcy + dy, pcz + dz);
+                    loaded++;
                 }
             }
         }
     }
+}
+
+typedef struct {
+    int distance;
+    int sx, sy, sz;
+} SectionOrder;
+
+int CompareSectionOrder(const void *a, const void *b) {
+    return ((const SectionOrder*)a)->distance - ((const SectionOrder*)b)->distance;
+}
+
+// Remeshes every section of a chunk, plus the sections of loaded neighbor chunks that share a face with it.
+// Sections are queued nearest to the player first, so the ones in view come back from the workers first.
+void ReloadChunk(const Chunk *chunk) {
+    PROFILE_ZONE("ReloadChunk");
+    SectionOrder order[(SECTIONS_PER_AXIS + 2) * (SECTIONS_PER_AXIS + 2) * (SECTIONS_PER_AXIS + 2)];
+    int count = 0;
+
+    int ox = chunk->cx * SECTIONS_PER_AXIS;
+    int oy = chunk->cy * SECTIONS_PER_AXIS;
+    int oz = chunk->cz * SECTIONS_PER_AXIS;
+
+    for (int sz = -1; sz <= SECTIONS_PER_AXIS; sz++) {
+        for (int sy = -1; sy <= SECTIONS_PER_AXIS; sy++) {
+            for (int sx = -1; sx <= SECTIONS_PER_AXIS; sx++) {
+                int outside = (sx < 0 || sx == SECTIONS_PER_AXIS) + (sy < 0 || sy == SECTIONS_PER_AXIS) + (sz < 0 || sz == SECTIONS_PER_AXIS);
+                if (outside > 1) continue;
+
+                Vector3 center = Vector3AddValue(Vector3Scale((Vector3){ ox + sx, oy + sy, oz + sz }, SECTION_SIZE), SECTION_SIZE / 2);
+                order[count++] = (SectionOrder){ (int)Vector3DistanceSqr(center, player.position), ox + sx, oy + sy, oz + sz };
+            }
+        }
+    }
+
+    qsort(order, count, sizeof(SectionOrder), CompareSectionOrder);
+    for (int i = 0; i < count; i++) {
+        ReloadSection(order[i].sx, order[i].sy, order[i].sz);
+    }
+}
+
+// Remeshes the section holding a changed block, plus the neighbors it shares a face with
+void ReloadBlock(int x, int y, int z) {
+    int sx = x >> SECTION_SHIFT;
+    int sy = y >> SECTION_SHIFT;
+    int sz = z >> SECTION_SHIFT;
+    int lx = x & (SECTION_SIZE - 1);
+    int ly = y & (SECTION_SIZE - 1);
+    int lz = z & (SECTION_SIZE - 1);
+
+    ReloadSection(sx, sy, sz);
+
+    if (lx == 0) ReloadSection(sx - 1, sy, sz);
+    if (lx == SECTION_SIZE - 1) ReloadSection(sx + 1, sy, sz);
+    if (ly == 0) ReloadSection(sx, sy - 1, sz);
+    if (ly == SECTION_SIZE - 1) ReloadSection(sx, sy + 1, sz);
+    if (lz == 0) ReloadSection(sx, sy, sz - 1);
+    if (lz == SECTION_SIZE - 1) ReloadSection(sx, sy, sz + 1);
+}
+
+// Remeshes the sections whose light changed since the last call. Those an edit or a chunk load
+// already remeshed after lighting are skipped, so each is snapshotted once.
+void ReloadLitSections() {
+    int mask = SECTIONS_PER_AXIS - 1;
+    for (int i = 0; i < lighting.sectionCount; i++) {
+        int *s = lighting.sections[i];
+        Chunk *chunk = FindChunk(&chunks, s[0] >> CHUNK_SECTION_SHIFT, s[1] >> CHUNK_SECTION_SHIFT, s[2] >> CHUNK_SECTION_SHIFT);
+        if (chunk != NULL && chunk->relit >> SectionIndex(s[0] & mask, s[1] & mask, s[2] & mask) & 1) {
+            ReloadSection(s[0], s[1], s[2]);
+        }
+    }
+    LightClearSections(&lighting, &chunks);
+}
+
+// Every section draws with the same index pattern, so one buffer covering the largest section is shared
+void LoadQuadIndexBuffer() {
+    unsigned short *indices = (unsigned short *)RL_MALLOC(MAX_SECTION_QUADS * 6 * sizeof(unsigned short));
+
+    for (int k = 0; k < MAX_SECTION_QUADS; k++) {
+        indices[k * 6] = 4*k;
+        indices[k * 6 + 1] = 4*k + 1;
+        indices[k * 6 + 2] = 4*k + 2;
+        indices[k * 6 + 3] = 4*k;
+        indices[k * 6 + 4] = 4*k + 2;
+        indices[k * 6 + 5] = 4*k + 3;
+    }
+
+    quadIndexBuffer = rlLoadVertexBufferElement(indices, MAX_SECTION_QUADS * 6 * sizeof(unsigned short), false);
+    RL_FREE(indices);
+}
+
+// Collects the non-empty sections of all loaded chunks into the cull list
+void GatherSections() {
+    PROFILE_ZONE("GatherSections");
+    int capacity = sectionBoxes.capacity;
+    BoxListReserve(&sectionBoxes, chunks.count * SECTION_COUNT);
+    if (sectionBoxes.capacity != capacity) {
+        sectionDraws = (SectionDraw *)realloc(sectionDraws, sectionBoxes.capacity * sizeof(SectionDraw));
+        sectionVisible = (unsigned char *)realloc(sectionVisible, sectionBoxes.capacity);
+    }
+
+    int count = 0;
+    for (int i = 0; i < chunks.capacity; i++) {
+        Chunk *chunk = chunks.slots[i].chunk;
+        if (chunk == NULL) continue;
+
+        for (int j = 0; j < SECTION_COUNT; j++) {
+            SectionMesh *mesh = &chunk->render->sections[j];
+            if (mesh->blocks.quadCount == 0 && mesh->sprites.quadCount == 0) continue;
+
+            Vector3 origin = {
+                chunk->cx * CHUNK_SIZE + (j % SECTIONS_PER_AXIS) * SECTION_SIZE,
+                chunk->cy * CHUNK_SIZE + (j / SECTIONS_PER_AXIS % SECTIONS_PER_AXIS) * SECTION_SIZE,
+                chunk->cz * CHUNK_SIZE + (j / (SECTIONS_PER_AXIS * SECTIONS_PER_AXIS)) * SECTION_SIZE
+            };
+            sectionDraws[count] = (SectionDraw){ mesh, origin };
+            BoxListSet(&sectionBoxes, count, origin, Vector3AddValue(origin, SECTION_SIZE));
+            count++;
+        }
+    }
+    sectionBoxes.count = count;
+}
+
+void DrawQuadBuffers(bool sprites) {
+    PROFILE_ZONE("DrawQuadBuffers");
+    for (int i = 0; i < sectionBoxes.count; i++) {
+        QuadBuffer *buffer = sprites ? &sectionDraws[i].mesh->sprites : &sectionDraws[i].mesh->blocks;
+        if (buffer->quadCount == 0 || !sectionVisible[i]) continue;
+
+        rlSetUniform(sectionOriginLoc, &sectionDraws[i].origin, RL_SHADER_UNIFORM_VEC3, 1);
+
+        rlEnableVertexArray(buffer->vaoId);
+        rlDrawVertexArrayElements(0, buffer->quadCount * 6, 0);
+    }
+}
+
+void DrawSections(Material material, Texture2D spriteTexture) {
+    PROFILE_ZONE("DrawSections");
+    Matrix mvp = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    int textureSlot = 0;
+
+    GatherSections();
+    Frustum frustum = FrustumFromMatrix(mvp);
+    {
+        PROFILE_ZONE("CullBoxes");
+        CullBoxes(&frustum, &sectionBoxes, sectionVisible);
+    }
 
-    UnloadMesh(worldMesh);
-
-    Mesh mesh = { 0 };
-    mesh.vertices = vert.data;
-    mesh.texcoords = tex.data;
-    mesh.normals = norm.data;
-    mesh.vertexCount = vert.size / 3;
-    mesh.triangleCount = vert.size / 6;
-    mesh.indices = (unsigned short *)RL_MALLOC(vert.size / 2 * sizeof(unsigned short));;
-
-    int k = 0;
-    for (int i = 0; i < vert.size / 2; i += 6) {
-        mesh.indices[i] = 4*k;
-        mesh.indices[i + 1] = 4*k + 1;
-        mesh.indices[i + 2] = 4*k + 2;
-        mesh.indices[i + 3] = 4*k;
-        mesh.indices[i + 4] = 4*k + 2;
-        mesh.indices[i + 5] = 4*k + 3;
-        k++;
+    cullStats.tested = sectionBoxes.count;
+    cullStats.drawn = 0;
+    for (int i = 0; i < sectionBoxes.count; i++) {
+        cullStats.drawn += sectionVisible[i];
     }
 
-    UploadMesh(&mesh, true);
-    worldMesh = mesh;
+    float blockAtlasTiles = 16.0f;
+    float spriteAtlasTiles = 8.0f;
+
+    rlEnableShader(material.shader.id);
+    rlSetUniformMatrix(material.shader.locs[SHADER_LOC_MATRIX_MVP], mvp);
+    rlActiveTextureSlot(textureSlot);
+    rlSetUniform(material.shader.locs[SHADER_LOC_MAP_DIFFUSE], &textureSlot, RL_SHADER_UNIFORM_INT, 1);
+
+    rlEnableTexture(material.maps[MATERIAL_MAP_DIFFUSE].texture.id);
+    rlSetUniform(atlasTilesLoc, &blockAtlasTiles, RL_SHADER_UNIFORM_FLOAT, 1);
+    DrawQuadBuffers(false);
+
+    // Crossed sprite quads are seen from both sides
+    rlDisableBackfaceCulling();
+    rlEnableTexture(spriteTexture.id);
+    rlSetUniform(atlasTilesLoc, &spriteAtlasTiles, RL_SHADER_UNIFORM_FLOAT, 1);
+    DrawQuadBuffers(true);
+    rlEnableBackfaceCulling();
+
+    rlDisableVertexArray();
+    rlDisableTexture();
+    rlDisableShader();
+}
+
+void LoadQuadBuffer(QuadBuffer *buffer, const Quad *quads, int quadCount) {
+    if (quadCount == 0) return;
+
+    buffer->vaoId = rlLoadVertexArray();
+    rlEnableVertexArray(buffer->vaoId);
+
+    // Each packed vertex is read as four unsigned bytes and reassembled in the shader
+    buffer->vboId = rlLoadVertexBuffer(quads, quadCount * sizeof(Quad), false);
+    rlSetVertexAttribute(VERTEX_DATA_LOCATION, 4, RL_UNSIGNED_BYTE, false, 0, 0);
+    rlEnableVertexAttribute(VERTEX_DATA_LOCATION);
+
+    // The element buffer binding is recorded in the VAO
+    rlEnableVertexBufferElement(quadIndexBuffer);
+    rlDisableVertexArray();
+
+    buffer->quadCount = quadCount;
+}
+
+void UnloadQuadBuffer(QuadBuffer *buffer) {
+    if (buffer->vaoId == 0) return;
+
+    rlUnloadVertexArray(buffer->vaoId);
+    rlUnloadVertexBuffer(buffer->vboId);
+    *buffer = (QuadBuffer){ 0 };
+}
+
+// Queues a section for remeshing, sx, sy and sz are world section coordinates.
+// Sections of chunks that are not loaded are skipped.
+void ReloadSection(int sx, int sy, int sz) {
+    Chunk *chunk = FindChunk(&chunks, sx >> CHUNK_SECTION_SHIFT, sy >> CHUNK_SECTION_SHIFT, sz >> CHUNK_SECTION_SHIFT);
+    if (chunk == NULL) return;
+
+    PROFILE_ZONE("ReloadSection");
+    int index = SectionIndex(sx & (SECTIONS_PER_AXIS - 1), sy & (SECTIONS_PER_AXIS - 1), sz & (SECTIONS_PER_AXIS - 1));
+    SectionMesh *section = &chunk->render->sections[index];
+
+    // The snapshot holds the current light, ReloadLitSections need not take another
+    chunk->relit &= ~(1ull << index);
+    RemeshQueueSubmit(&remeshQueue, &chunks, &section->queued, chunk->loadId, ++section->submitted, sx, sy, sz);
+}
+
+// Uploads meshes finished by the workers, sections keep drawing their old mesh until then
+void UploadFinishedSections() {
+    PROFILE_ZONE("UploadFinishedSections");
+    RemeshResult results[SECTION_COUNT];
+    int count;
+
+    while ((count = RemeshQueuePoll(&remeshQueue, results, SECTION_COUNT)) > 0) {
+        for (int i = 0; i < count; i++) {
+            RemeshResult *result = &results[i];
+            Chunk *chunk = FindChunk(&chunks, result->sx >> CHUNK_SECTION_SHIFT, result->sy >> CHUNK_SECTION_SHIFT, result->sz >> CHUNK_SECTION_SHIFT);
+
+            // The chunk may have been unloaded, or unloaded and loaded again, while the job ran
+            if (chunk == NULL || chunk->loadId != result->loadId) {
+                free(result->quads);
+                continue;
+            }
+
+            SectionMesh *section = &chunk->render->sections[SectionIndex(result->sx & (SECTIONS_PER_AXIS - 1), result->sy & (SECTIONS_PER_AXIS - 1), result->sz & (SECTIONS_PER_AXIS - 1))];
+
+            // A newer edit may already have been uploaded if workers finished out of order
+            if (result->version <= section->version) {
+                free(result->quads);
+                continue;
+            }
+
+            UnloadQuadBuffer(&section->blocks);
+            UnloadQuadBuffer(&section->sprites);
+            section->version = result->version;
+
+            // Sprite quads follow the block quads in the result
+            LoadQuadBuffer(&section->blocks, result->quads, result->info.quads);
+            LoadQuadBuffer(&section->sprites, result->quads + result->info.quads, result->info.spriteQuads);
+
+            free(result->quads);
+        }
+    }
 }
\ No newline at end of file
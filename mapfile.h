@@ -0,0 +1,102 @@
+// Read-only memory mapped files and durable file replacement over Win32 and POSIX
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOGDI
+    #define NOUSER
+    #include <windows.h>
+    #include <io.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+} MappedFile;
+
+// Maps a whole file. Fails for missing and empty files.
+bool MapFile(MappedFile *mapped, const char *name) {
+    *mapped = (MappedFile){ 0 };
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    // The view keeps the mapping alive once both handles are closed
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return false;
+
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == NULL) return false;
+
+    mapped->data = (const unsigned char*)data;
+    mapped->size = (size_t)size.QuadPart;
+#else
+    int fd = open(name, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    mapped->data = (const unsigned char*)data;
+    mapped->size = (size_t)info.st_size;
+#endif
+    return true;
+}
+
+void UnmapFile(MappedFile *mapped) {
+    if (mapped->data == NULL) return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile((void*)mapped->data);
+#else
+    munmap((void*)mapped->data, mapped->size);
+#endif
+    *mapped = (MappedFile){ 0 };
+}
+
+// Flushes a written file down to the disk, not just to the OS
+bool FileSync(FILE *file) {
+    if (fflush(file) != 0) return false;
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Atomically replaces target with source, readers see either the old or the new file
+bool FileReplace(const char *source, const char *target) {
+#if defined(_WIN32)
+    return MoveFileExA(source, target, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (rename(source, target) != 0) return false;
+
+    // The rename itself is only durable once the directory is synced
+    int fd = open(".", O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return true;
+#endif
+}
\ No newline at end of file
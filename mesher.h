@@ -0,0 +1,327 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+// Face order: +Z, -Z, +Y, -Y, +X, -X, then the two diagonal planes of crossed sprites (4 vertices each)
+const int faceVertices[] = {
+    0, 0, 1,
+    1, 0, 1,
+    1, 1, 1,
+    0, 1, 1,
+    0, 0, 0,
+    0, 1, 0,
+    1, 1, 0,
+    1, 0, 0,
+    0, 1, 0,
+    0, 1, 1,
+    1, 1, 1,
+    1, 1, 0,
+    0, 0, 0,
+    1, 0, 0,
+    1, 0, 1,
+    0, 0, 1,
+    1, 0, 0,
+    1, 1, 0,
+    1, 1, 1,
+    1, 0, 1,
+    0, 0, 0,
+    0, 0, 1,
+    0, 1, 1,
+    0, 1, 0,
+    0, 0, 0,
+    1, 0, 1,
+    1, 1, 1,
+    0, 1, 0,
+    1, 0, 0,
+    0, 0, 1,
+    0, 1, 1,
+    1, 1, 0
+};
+
+#define SPRITE_FACE_A 6
+#define SPRITE_FACE_B 7
+
+// Packed vertex layout, decoded in shaders/vertex.glsl:
+// bits 0-14 section-local position (5 bits per axis), 15-17 face, 18-19 corner, 20-27 atlas tile, 28-31 light
+#define PACK_VERTEX(x, y, z, face, corner, tile, light) \
+    ((uint32_t)(x) | (uint32_t)(y) << 5 | (uint32_t)(z) << 10 | (uint32_t)(face) << 15 | (uint32_t)(corner) << 18 | (uint32_t)(tile) << 20 | (uint32_t)(light) << 28)
+
+// Worst case is a 3D checkerboard: half the blocks solid, all six faces exposed and none mergeable
+#define MAX_SECTION_QUADS (SECTION_SIZE * SECTION_SIZE * SECTION_SIZE / 2 * 6)
+
+// Sections are small enough that every quad vertex is reachable with 16-bit indices
+_Static_assert(MAX_SECTION_QUADS * 4 <= 65536, "section quads must fit 16-bit indices");
+
+// Sprites go in their own mesh, two crossed quads per sprite block
+#define MAX_SECTION_SPRITE_QUADS (SECTION_SIZE * SECTION_SIZE * SECTION_SIZE * 2)
+_Static_assert(MAX_SECTION_SPRITE_QUADS <= MAX_SECTION_QUADS, "sprite quads must fit the shared index buffer");
+
+// Blocks of one section plus a one block border from its neighbors, copied out of the world
+// so a section can be meshed away from the main thread while the world keeps changing
+#define SNAPSHOT_SIZE (SECTION_SIZE + 2)
+
+typedef struct {
+    int blocks[SNAPSHOT_SIZE * SNAPSHOT_SIZE * SNAPSHOT_SIZE];
+    // Sky and block light of the same blocks, faces show the light of the block in front of them
+    uint8_t light[SNAPSHOT_SIZE * SNAPSHOT_SIZE * SNAPSHOT_SIZE];
+    // Sprite blocks of the section from the sprite registry, as section-local x + y * 16 + z * 256
+    int spriteCount;
+    unsigned short sprites[SECTION_SIZE * SECTION_SIZE * SECTION_SIZE];
+} SectionSnapshot;
+
+typedef struct {
+    // Occupancy columns per axis: cols[axis][u][v], bit d + 1 set when the block at local depth d is solid.
+    // Bits 0 and SECTION_SIZE + 1 hold the neighboring sections so boundary faces are culled too.
+    // u and v are the coordinates on axes (axis + 1) % 3 and (axis + 2) % 3.
+    uint64_t cols[3][SECTION_SIZE][SECTION_SIZE];
+    // Visible faces per direction: planes[face][d][u], bit v set when the face at depth d is exposed
+    uint64_t planes[6][SECTION_SIZE][SECTION_SIZE];
+} GreedyMesher;
+
+typedef struct {
+    int faces;  // Exposed block faces, what an unmerged mesh would hold
+    int quads;  // Quads left after greedy merging
+    int spriteQuads;  // Crossed quads of sprite blocks, stored after the block quads
+} SectionMeshInfo;
+
+// Local coordinates run from -1 to SECTION_SIZE inclusive
+static inline int SnapshotIndex(int x, int y, int z) {
+    return (x + 1) + (y + 1) * SNAPSHOT_SIZE + (z + 1) * SNAPSHOT_SIZE * SNAPSHOT_SIZE;
+}
+
+static inline int BlockAt(const SectionSnapshot *snapshot, int axis, int d, int u, int v) {
+    int p[3];
+    p[axis] = d;
+    p[(axis + 1) % 3] = u;
+    p[(axis + 2) % 3] = v;
+    return snapshot->blocks[SnapshotIndex(p[0], p[1], p[2])];
+}
+
+// The brighter of a block's sky and block light
+static inline int SnapshotLight(const SectionSnapshot *snapshot, int x, int y, int z) {
+    uint8_t light = snapshot->light[SnapshotIndex(x, y, z)];
+    int sky = light >> LIGHT_SKY_SHIFT;
+    int block = light & LIGHT_MAX;
+    return sky > block ? sky : block;
+}
+
+// Light of the face at depth d of a plane, taken from the block it faces
+static inline int FaceLightAt(const SectionSnapshot *snapshot, int face, int d, int u, int v) {
+    int axis = 2 - face / 2;
+    int p[3];
+    p[axis] = face % 2 == 0 ? d + 1 : d - 1;
+    p[(axis + 1) % 3] = u;
+    p[(axis + 2) % 3] = v;
+    return SnapshotLight(snapshot, p[0], p[1], p[2]);
+}
+
+// Copies a section and its border out of the world, sx, sy and sz are world section coordinates.
+// Blocks in chunks that are not loaded read as air, lit by open sky.
+void TakeSectionSnapshot(SectionSnapshot *snapshot, const ChunkMap *map, int sx, int sy, int sz) {
+    int ox = sx * SECTION_SIZE;
+    int oy = sy * SECTION_SIZE;
+    int oz = sz * SECTION_SIZE;
+
+    Chunk *chunk = FindChunk(map, sx >> CHUNK_SECTION_SHIFT, sy >> CHUNK_SECTION_SHIFT, sz >> CHUNK_SECTION_SHIFT);
+    int lx = ox & (CHUNK_SIZE - 1);
+    int ly = oy & (CHUNK_SIZE - 1);
+    int lz = oz & (CHUNK_SIZE - 1);
+    int section = SectionIndex(lx >> SECTION_SHIFT, ly >> SECTION_SHIFT, lz >> SECTION_SHIFT);
+
+    for (int z = -1; z <= SECTION_SIZE; z++) {
+        for (int y = -1; y <= SECTION_SIZE; y++) {
+            bool border = y < 0 || z < 0 || y == SECTION_SIZE || z == SECTION_SIZE;
+            int *row = &snapshot->blocks[SnapshotIndex(0, y, z)];
+            uint8_t *lightRow = &snapshot->light[SnapshotIndex(0, y, z)];
+
+            if (border) {
+                for (int x = -1; x <= SECTION_SIZE; x++) {
+                    row[x] = GetBlock(map, ox + x, oy + y, oz + z);
+                    lightRow[x] = GetLight(map, ox + x, oy + y, oz + z);
+                }
+                continue;
+            }
+
+            // Interior rows are contiguous along x, decode them in one go
+            row[-1] = GetBlock(map, ox - 1, oy + y, oz + z);
+            lightRow[-1] = GetLight(map, ox - 1, oy + y, oz + z);
+            if (chunk) {
+                int index = ChunkIndex(lx, ly + y, lz + z);
+                PackedBlocksGetRun(&chunk->blocks, index, SECTION_SIZE, row);
+                const uint8_t *light = chunk->light[section];
+                if (light != NULL) memcpy(lightRow, &light[SectionOffsetOfBlock(index)], SECTION_SIZE);
+                else memset(lightRow, chunk->uniformLight[section], SECTION_SIZE);
+            } else {
+                memset(row, 0, SECTION_SIZE * sizeof(int));
+                memset(lightRow, LIGHT_MAX << LIGHT_SKY_SHIFT, SECTION_SIZE);
+            }
+            row[SECTION_SIZE] = GetBlock(map, ox + SECTION_SIZE, oy + y, oz + z);
+            lightRow[SECTION_SIZE] = GetLight(map, ox + SECTION_SIZE, oy + y, oz + z);
+        }
+    }
+
+    snapshot->spriteCount = 0;
+    if (chunk == NULL) return;
+
+    const SpriteList *sprites = &chunk->sprites[section];
+    snapshot->spriteCount = sprites->count;
+    for (int i = 0; i < sprites->count; i++) {
+        int x, y, z;
+        ChunkPosition(sprites->blocks[i], &x, &y, &z);
+        x -= lx;
+        y -= ly;
+        z -= lz;
+        snapshot->sprites[i] = x + y * SECTION_SIZE + z * SECTION_SIZE * SECTION_SIZE;
+    }
+}
+
+void EmitQuad(MeshArena *arena, int face, int type, int light, const int origin[3], const int size[3]) {
+    Quad *quad = appendQuads(arena, 1);
+
+    for (int corner = 0; corner < 4; corner++) {
+        int i = face * 4 + corner;
+        quad->vertices[corner] = PACK_VERTEX(
+            faceVertices[i * 3 + 0] * size[0] + origin[0],
+            faceVertices[i * 3 + 1] * size[1] + origin[1],
+            faceVertices[i * 3 + 2] * size[2] + origin[2],
+            face, corner, type, light);
+    }
+}
+
+// Merges the exposed faces in rows[][] into maximal rectangles of the same block type and light, clearing them.
+// Returns how many quads were written to the arena.
+int GreedyMergePlane(uint64_t rows[SECTION_SIZE][SECTION_SIZE], const SectionSnapshot *snapshot, int face, MeshArena *arena) {
+    int axis = 2 - face / 2;
+    int quads = 0;
+
+    for (int d = 0; d < SECTION_SIZE; d++) {
+        for (int u = 0; u < SECTION_SIZE; u++) {
+            while (rows[d][u]) {
+                int v = __builtin_ctzll(rows[d][u]);
+                int type = BlockAt(snapshot, axis, d, u, v);
+                int light = FaceLightAt(snapshot, face, d, u, v);
+
+                // Grow along v while faces are set and share the block type and light
+                int w = 1;
+                while (v + w < SECTION_SIZE && (rows[d][u] >> (v + w) & 1) && BlockAt(snapshot, axis, d, u, v + w) == type &&
+                       FaceLightAt(snapshot, face, d, u, v + w) == light) {
+                    w++;
+                }
+
+                uint64_t run = ((1ull << w) - 1) << v;
+
+                // Grow along u while the next row holds the whole run with the same type and light
+                int h = 1;
+                while (u + h < SECTION_SIZE && (rows[d][u + h] & run) == run) {
+                    int same = 1;
+                    for (int k = 0; k < w; k++) {
+                        if (BlockAt(snapshot, axis, d, u + h, v + k) != type || FaceLightAt(snapshot, face, d, u + h, v + k) != light) {
+                            same = 0;
+                            break;
+                        }
+                    }
+                    if (!same) break;
+                    rows[d][u + h] &= ~run;
+                    h++;
+                }
+                rows[d][u] &= ~run;
+                quads++;
+
+                int quadOrigin[3], size[3];
+                quadOrigin[axis] = d;
+                quadOrigin[(axis + 1) % 3] = u;
+                quadOrigin[(axis + 2) % 3] = v;
+                size[axis] = 1;
+                size[(axis + 1) % 3] = h;
+                size[(axis + 2) % 3] = w;
+
+                EmitQuad(arena, face, type - 1, light, quadOrigin, size);
+            }
+        }
+    }
+
+    return quads;
+}
+
+// Builds the face planes of a section snapshot and counts its faces with popcounts. Only positive ids are solid.
+// Faces bound the quads EmitSectionMesh writes, so callers can budget before meshing. quads is left 0.
+SectionMeshInfo CountSectionMesh(GreedyMesher *m, const SectionSnapshot *snapshot) {
+    SectionMeshInfo info = { 0 };
+    memset(m->cols, 0, sizeof(m->cols));
+    memset(m->planes, 0, sizeof(m->planes));
+
+    for (int z = -1; z <= SECTION_SIZE; z++) {
+        for (int y = -1; y <= SECTION_SIZE; y++) {
+            for (int x = -1; x <= SECTION_SIZE; x++) {
+                bool inX = x >= 0 && x < SECTION_SIZE;
+                bool inY = y >= 0 && y < SECTION_SIZE;
+                bool inZ = z >= 0 && z < SECTION_SIZE;
+                if (inX + inY + inZ < 2) continue;
+                if (snapshot->blocks[SnapshotIndex(x, y, z)] <= 0) continue;
+
+                if (inY && inZ) m->cols[0][y][z] |= 1ull << (x + 1);
+                if (inZ && inX) m->cols[1][z][x] |= 1ull << (y + 1);
+                if (inX && inY) m->cols[2][x][y] |= 1ull << (z + 1);
+            }
+        }
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        for (int positive = 1; positive >= 0; positive--) {
+            int face = (2 - axis) * 2 + !positive;
+
+            for (int u = 0; u < SECTION_SIZE; u++) {
+                for (int v = 0; v < SECTION_SIZE; v++) {
+                    uint64_t col = m->cols[axis][u][v];
+                    uint64_t faces = positive ? col & ~(col >> 1) : col & ~(col << 1);
+                    faces = (faces >> 1) & ((1ull << SECTION_SIZE) - 1);
+                    info.faces += __builtin_popcountll(faces);
+
+                    while (faces) {
+                        int d = __builtin_ctzll(faces);
+                        m->planes[face][d][u] |= 1ull << v;
+                        faces &= faces - 1;
+                    }
+                }
+            }
+        }
+    }
+
+    info.spriteQuads = snapshot->spriteCount * 2;
+    return info;
+}
+
+// Sprites sample other.png, an 8x8 atlas addressed like the billboards were: the source
+// rectangle of id - 1 wraps around the texture, so negative ids count back from the last column
+static inline int SpriteTile(int id) {
+    int type = id - 1;
+    int col = (type % 8 + 8) % 8;
+    int row = (type / 8 % 8 + 8) % 8;
+    return col + row * 8;
+}
+
+void EmitSprites(const SectionSnapshot *snapshot, MeshArena *arena) {
+    int size[3] = { 1, 1, 1 };
+
+    for (int i = 0; i < snapshot->spriteCount; i++) {
+        int local = snapshot->sprites[i];
+        int origin[3] = { local % SECTION_SIZE, local / SECTION_SIZE % SECTION_SIZE, local / (SECTION_SIZE * SECTION_SIZE) };
+        int tile = SpriteTile(snapshot->blocks[SnapshotIndex(origin[0], origin[1], origin[2])]);
+        int light = SnapshotLight(snapshot, origin[0], origin[1], origin[2]);
+
+        EmitQuad(arena, SPRITE_FACE_A, tile, light, origin, size);
+        EmitQuad(arena, SPRITE_FACE_B, tile, light, origin, size);
+    }
+}
+
+// Second pass: merges the planes built by CountSectionMesh and appends the quads to the arena
+// as packed words with positions relative to the section origin, followed by the sprite quads.
+// Consumes the planes. Returns the number of block quads.
+int EmitSectionMesh(GreedyMesher *m, const SectionSnapshot *snapshot, MeshArena *arena) {
+    int quads = 0;
+    for (int face = 0; face < 6; face++) {
+        quads += GreedyMergePlane(m->planes[face], snapshot, face, arena);
+    }
+
+    EmitSprites(snapshot, arena);
+    return quads;
+}
\ No newline at end of file
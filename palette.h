@@ -0,0 +1,203 @@
+// Palette compressed block storage. Each block stores an index into a small table of the block ids
+// that occur in it, packed at 1, 2, 4, 8 or 16 bits. The width doubles when the table fills up.
+// Widths divide 64, so an index never straddles two words.
+typedef struct {
+    int *palette;
+    int paletteCount;
+    int paletteCapacity;
+    int bits;
+    int shift;  // log2 of indices per word
+    uint64_t *words;
+    int volume;  // Number of blocks, a multiple of 64
+    // Owner count of palette and words while shared with save snapshots, NULL when not shared.
+    // Only touched on the main thread, the save worker just reads shared data.
+    int *refs;
+} PackedBlocks;
+
+#define PACKED_MAX_BITS 16
+
+static inline int PackedEntry(const PackedBlocks *blocks, int index) {
+    uint64_t word = blocks->words[index >> blocks->shift];
+    int offset = (index & ((1 << blocks->shift) - 1)) * blocks->bits;
+    return (int)(word >> offset) & ((1 << blocks->bits) - 1);
+}
+
+static inline void PackedSetEntry(PackedBlocks *blocks, int index, int entry) {
+    uint64_t *word = &blocks->words[index >> blocks->shift];
+    int offset = (index & ((1 << blocks->shift) - 1)) * blocks->bits;
+    uint64_t mask = (((uint64_t)1 << blocks->bits) - 1) << offset;
+    *word = (*word & ~mask) | ((uint64_t)entry << offset);
+}
+
+static inline int PackedBlocksGet(const PackedBlocks *blocks, int index) {
+    return blocks->palette[PackedEntry(blocks, index)];
+}
+
+// Decodes count consecutive blocks, a word at a time
+void PackedBlocksGetRun(const PackedBlocks *blocks, int index, int count, int *out) {
+    int perWord = 1 << blocks->shift;
+    int entryMask = (1 << blocks->bits) - 1;
+
+    while (count > 0) {
+        uint64_t word = blocks->words[index >> blocks->shift];
+        int first = index & (perWord - 1);
+        int n = perWord - first < count ? perWord - first : count;
+
+        word >>= first * blocks->bits;
+        for (int i = 0; i < n; i++) {
+            *out++ = blocks->palette[(int)word & entryMask];
+            word >>= blocks->bits;
+        }
+
+        index += n;
+        count -= n;
+    }
+}
+
+static void PackedBlocksSetBits(PackedBlocks *blocks, int bits, uint64_t *words) {
+    blocks->bits = bits;
+    blocks->shift = 0;
+    while ((bits << blocks->shift) < 64) blocks->shift++;
+    blocks->words = words;
+}
+
+static inline size_t PackedWordCount(int volume, int bits) {
+    return (size_t)volume * bits / 64;
+}
+
+void PackedBlocksInit(PackedBlocks *blocks, int volume, int fill) {
+    blocks->volume = volume;
+    blocks->refs = NULL;
+    blocks->paletteCapacity = 2;
+    blocks->palette = (int*)malloc(blocks->paletteCapacity * sizeof(int));
+    blocks->palette[0] = fill;
+    blocks->paletteCount = 1;
+    PackedBlocksSetBits(blocks, 1, (uint64_t*)calloc(PackedWordCount(volume, 1), sizeof(uint64_t)));
+}
+
+// Storage for a known palette at the smallest width that fits it, every block starts at entry 0
+void PackedBlocksInitPalette(PackedBlocks *blocks, int volume, const int *palette, int count) {
+    int bits = 1;
+    while (1 << bits < count) bits *= 2;
+
+    blocks->volume = volume;
+    blocks->refs = NULL;
+    blocks->paletteCapacity = count > 2 ? count : 2;
+    blocks->palette = (int*)malloc(blocks->paletteCapacity * sizeof(int));
+    memcpy(blocks->palette, palette, count * sizeof(int));
+    blocks->paletteCount = count;
+    PackedBlocksSetBits(blocks, bits, (uint64_t*)calloc(PackedWordCount(volume, bits), sizeof(uint64_t)));
+}
+
+void PackedBlocksFree(PackedBlocks *blocks) {
+    if (blocks->refs == NULL || --*blocks->refs == 0) {
+        free(blocks->refs);
+        free(blocks->palette);
+        free(blocks->words);
+    }
+    *blocks = (PackedBlocks){ 0 };
+}
+
+// Makes copy a copy-on-write view of blocks. Whichever side is written first takes its own copy.
+void PackedBlocksShare(PackedBlocks *blocks, PackedBlocks *copy) {
+    if (blocks->refs == NULL) {
+        blocks->refs = (int*)malloc(sizeof(int));
+        *blocks->refs = 1;
+    }
+    (*blocks->refs)++;
+    *copy = *blocks;
+}
+
+// Takes a private copy of shared data before it is written
+static void PackedBlocksUnshare(PackedBlocks *blocks) {
+    if (blocks->refs == NULL) return;
+
+    if (*blocks->refs == 1) {
+        free(blocks->refs);
+    } else {
+        (*blocks->refs)--;
+
+        int *palette = (int*)malloc(blocks->paletteCapacity * sizeof(int));
+        memcpy(palette, blocks->palette, blocks->paletteCount * sizeof(int));
+        blocks->palette = palette;
+
+        size_t size = PackedWordCount(blocks->volume, blocks->bits) * sizeof(uint64_t);
+        uint64_t *words = (uint64_t*)malloc(size);
+        memcpy(words, blocks->words, size);
+        blocks->words = words;
+    }
+    blocks->refs = NULL;
+}
+
+// Repacks every index at a new width, the palette order is kept
+static void PackedBlocksRepack(PackedBlocks *blocks, int bits) {
+    PackedBlocks old = *blocks;
+    PackedBlocksSetBits(blocks, bits, (uint64_t*)calloc(PackedWordCount(old.volume, bits), sizeof(uint64_t)));
+
+    for (int i = 0; i < old.volume; i++) {
+        PackedSetEntry(blocks, i, PackedEntry(&old, i));
+    }
+    free(old.words);
+}
+
+static int PackedPaletteFind(const PackedBlocks *blocks, int id) {
+    for (int i = 0; i < blocks->paletteCount; i++) {
+        if (blocks->palette[i] == id) return i;
+    }
+    return -1;
+}
+
+static int PackedPaletteAdd(PackedBlocks *blocks, int id) {
+    if (blocks->paletteCount == blocks->paletteCapacity) {
+        blocks->paletteCapacity *= 2;
+        blocks->palette = (int*)realloc(blocks->palette, blocks->paletteCapacity * sizeof(int));
+    }
+    blocks->palette[blocks->paletteCount] = id;
+    return blocks->paletteCount++;
+}
+
+// Ids that are no longer used keep their palette entry until the blocks are rebuilt from an array
+void PackedBlocksSet(PackedBlocks *blocks, int index, int id) {
+    PackedBlocksUnshare(blocks);
+    int entry = PackedPaletteFind(blocks, id);
+
+    if (entry < 0) {
+        if (blocks->paletteCount == 1 << blocks->bits) {
+            assert(blocks->bits < PACKED_MAX_BITS);
+            PackedBlocksRepack(blocks, blocks->bits * 2);
+        }
+        entry = PackedPaletteAdd(blocks, id);
+    }
+
+    PackedSetEntry(blocks, index, entry);
+}
+
+// Builds storage at the smallest width that fits the ids in the array
+void PackedBlocksFromArray(PackedBlocks *blocks, const int *ids, int volume) {
+    PackedBlocksInit(blocks, volume, ids[0]);
+
+    // Neighboring blocks usually match, so remember the last lookup
+    int lastID = ids[0];
+    for (int i = 1; i < volume; i++) {
+        if (ids[i] != lastID && PackedPaletteFind(blocks, ids[i]) < 0) {
+            assert(blocks->paletteCount < 1 << PACKED_MAX_BITS);
+            PackedPaletteAdd(blocks, ids[i]);
+        }
+        lastID = ids[i];
+    }
+
+    int bits = 1;
+    while (1 << bits < blocks->paletteCount) bits *= 2;
+    free(blocks->words);
+    PackedBlocksSetBits(blocks, bits, (uint64_t*)calloc(PackedWordCount(volume, bits), sizeof(uint64_t)));
+
+    int lastEntry = 0;
+    lastID = ids[0];
+    for (int i = 0; i < volume; i++) {
+        if (ids[i] != lastID) {
+            lastEntry = PackedPaletteFind(blocks, ids[i]);
+            lastID = ids[i];
+        }
+        PackedSetEntry(blocks, i, lastEntry);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+// Player physics, advanced one fixed tick at a time. A tick reads only the blocks and the input it
+// is given, so the same inputs give the same path at any frame rate, and the simulation can run
+// without a window.
+
+typedef struct {
+    float forward;  // -1 to 1, along yaw
+    float right;
+    float yaw;      // View direction the movement is relative to
+    bool jump;
+} PlayerInput;
+
+typedef struct {
+    Vector3 position;  // Centre of the feet
+    Vector3 velocity;
+    float yaw;    // View, turned by the mouse every frame
+    float pitch;
+    bool onGround;
+} Player;
+
+const float GRAVITY = -9.8f;
+const float JUMP_FORCE = 6.0f;
+const float PLAYER_SPEED = 8.0f;
+const float PLAYER_RADIUS = 0.3f;
+const float PLAYER_HEIGHT = 1.8f;
+const float PLAYER_EYE_HEIGHT = 1.6f;
+
+// The box the player occupies when standing at position
+BoundingBox PlayerBox(Vector3 position) {
+    return (BoundingBox){
+        { position.x - PLAYER_RADIUS, position.y, position.z - PLAYER_RADIUS },
+        { position.x + PLAYER_RADIUS, position.y + PLAYER_HEIGHT, position.z + PLAYER_RADIUS }
+    };
+}
+
+void SimulatePlayer(Player *player, const ChunkMap *map, PlayerInput input, float deltaTime) {
+    player->velocity.y += GRAVITY * deltaTime;
+
+    Vector3 forward = { cosf(input.yaw), 0, sinf(input.yaw) };
+    Vector3 right = { -sinf(input.yaw), 0, cosf(input.yaw) };
+
+    Vector3 movement = Vector3Add(
+        Vector3Scale(forward, input.forward),
+        Vector3Scale(right, input.right)
+    );
+
+    movement.y = 0;
+    if(Vector3Length(movement) > 0) {
+        movement = Vector3Scale(Vector3Normalize(movement), PLAYER_SPEED * deltaTime);
+    }
+
+    if (input.jump && player->onGround) {
+        player->velocity.y = JUMP_FORCE;
+    }
+
+    // Swept against the blocks, so a fast fall cannot pass through the ground
+    BoundingBox box = PlayerBox(player->position);
+    bool blocked[3];
+    Vector3 moved = MoveBox(map, &box, (Vector3){ movement.x, player->velocity.y * deltaTime, movement.z }, blocked);
+    player->position = Vector3Add(player->position, moved);
+
+    player->onGround = blocked[1] && player->velocity.y < 0;
+    if (blocked[1]) player->velocity.y = 0;
+}
\ No newline at end of file
@@ -0,0 +1,270 @@
+// Scoped frame profiler. PROFILE_ZONE("name") times the rest of the enclosing block into a ring
+// buffer owned by the calling thread, so recording never takes a lock. The main thread folds its
+// zones into a per-frame history for the overlay, and ProfilerDumpTrace writes every thread's
+// buffer as Chrome trace JSON (chrome://tracing or ui.perfetto.dev).
+//
+// Recording is off until ProfilerSetEnabled, a zone then costs one branch. Building with
+// -DPROFILER_DISABLED compiles the zones out entirely.
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOGDI
+    #define NOUSER
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+#define PROFILE_EVENTS (1 << 14)  // Per thread ring, a power of two
+#define PROFILE_MAX_THREADS 32
+#define PROFILE_FRAMES 120        // Frames of history in the overlay
+#define PROFILE_MAX_ZONES 32      // Distinct main thread zone names in the overlay
+
+typedef struct {
+    const char *name;  // Zone names are string literals, compared by pointer
+    uint64_t start;    // Nanoseconds on the profiler clock
+    uint64_t end;
+    int depth;
+} ProfileEvent;
+
+typedef struct {
+    ProfileEvent events[PROFILE_EVENTS];
+    _Atomic uint32_t written;  // Events ever finished, the next goes to written % PROFILE_EVENTS
+    const char *name;
+    int depth;
+} ProfileThread;
+
+typedef struct {
+    const char *name;
+    int depth;
+    float ms[PROFILE_FRAMES];
+} ProfileZoneHistory;
+
+typedef struct {
+    _Atomic bool enabled;  // Toggled on the main thread, read by every thread that opens a zone
+    ProfileThread *threads[PROFILE_MAX_THREADS];
+    _Atomic int threadCount;
+
+    // Main thread frame history for the overlay
+    uint64_t frameStart;
+    uint32_t frameRead;  // Main thread events already folded into the history
+    int frame;
+    float frameMs[PROFILE_FRAMES];
+    ProfileZoneHistory zones[PROFILE_MAX_ZONES];
+    int zoneCount;
+} Profiler;
+
+Profiler profiler = { 0 };
+_Thread_local ProfileThread *profileThread = NULL;
+
+uint64_t ProfileNow() {
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency = { 0 };
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart * 1000000000ull + counter.QuadPart % frequency.QuadPart * 1000000000ull / frequency.QuadPart);
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000ull + time.tv_nsec;
+#endif
+}
+
+// The calling thread's ring, created on first use. Threads past PROFILE_MAX_THREADS are not recorded.
+ProfileThread *ProfileCurrentThread() {
+    if (profileThread != NULL) return profileThread;
+
+    int index = atomic_fetch_add(&profiler.threadCount, 1);
+    if (index >= PROFILE_MAX_THREADS) return NULL;
+
+    profileThread = (ProfileThread *)calloc(1, sizeof(ProfileThread));
+    profiler.threads[index] = profileThread;
+    return profileThread;
+}
+
+// Names the calling thread in traces
+void ProfileThreadName(const char *name) {
+    ProfileThread *thread = ProfileCurrentThread();
+    if (thread != NULL) thread->name = name;
+}
+
+typedef struct {
+    const char *name;
+    uint64_t start;  // 0 when recording was off as the zone began
+} ProfileZone;
+
+static inline ProfileZone ProfileBegin(const char *name) {
+    ProfileZone zone = { name, 0 };
+    if (!atomic_load_explicit(&profiler.enabled, memory_order_relaxed)) return zone;
+
+    ProfileThread *thread = ProfileCurrentThread();
+    if (thread == NULL) return zone;
+
+    thread->depth++;
+    zone.start = ProfileNow();
+    return zone;
+}
+
+static inline void ProfileEnd(ProfileZone *zone) {
+    if (zone->start == 0) return;
+
+    ProfileThread *thread = profileThread;
+    uint32_t written = atomic_load_explicit(&thread->written, memory_order_relaxed);
+    thread->depth--;
+    thread->events[written & (PROFILE_EVENTS - 1)] = (ProfileEvent){ zone->name, zone->start, ProfileNow(), thread->depth };
+    atomic_store_explicit(&thread->written, written + 1, memory_order_release);
+}
+
+#if defined(PROFILER_DISABLED)
+    #define PROFILE_ZONE(name)
+#else
+    #define PROFILE_CONCAT_(a, b) a##b
+    #define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+    #define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__) __attribute__((cleanup(ProfileEnd))) = ProfileBegin(name)
+#endif
+
+void ProfilerSetEnabled(bool enabled) {
+    if (enabled && !profiler.enabled) {
+        ProfileThread *thread = ProfileCurrentThread();
+        if (thread != NULL) profiler.frameRead = atomic_load(&thread->written);
+        profiler.frameStart = ProfileNow();
+    }
+    atomic_store_explicit(&profiler.enabled, enabled, memory_order_relaxed);
+}
+
+static ProfileZoneHistory *ProfileFindZone(const char *name, int depth) {
+    for (int i = 0; i < profiler.zoneCount; i++) {
+        if (profiler.zones[i].name == name) return &profiler.zones[i];
+    }
+    if (profiler.zoneCount == PROFILE_MAX_ZONES) return NULL;
+
+    ProfileZoneHistory *zone = &profiler.zones[profiler.zoneCount++];
+    memset(zone, 0, sizeof(ProfileZoneHistory));
+    zone->name = name;
+    zone->depth = depth;
+    return zone;
+}
+
+// Ends a frame on the main thread: records it as a zone and folds the zones that finished during
+// it into the overlay history
+void ProfileFrame() {
+    if (!profiler.enabled) return;
+
+    ProfileThread *thread = ProfileCurrentThread();
+    if (thread == NULL) return;
+
+    uint64_t now = ProfileNow();
+    uint32_t written = atomic_load(&thread->written);
+    thread->events[written & (PROFILE_EVENTS - 1)] = (ProfileEvent){ "Frame", profiler.frameStart, now, -1 };
+    atomic_store_explicit(&thread->written, written + 1, memory_order_release);
+
+    profiler.frame = (profiler.frame + 1) % PROFILE_FRAMES;
+    profiler.frameMs[profiler.frame] = (now - profiler.frameStart) / 1e6f;
+    for (int i = 0; i < profiler.zoneCount; i++) {
+        profiler.zones[i].ms[profiler.frame] = 0;
+    }
+
+    if (written - profiler.frameRead > PROFILE_EVENTS) profiler.frameRead = written - PROFILE_EVENTS;
+    for (uint32_t i = profiler.frameRead; i != written; i++) {
+        ProfileEvent *event = &thread->events[i & (PROFILE_EVENTS - 1)];
+        ProfileZoneHistory *zone = ProfileFindZone(event->name, event->depth);
+        if (zone != NULL) zone->ms[profiler.frame] += (event->end - event->start) / 1e6f;
+    }
+
+    profiler.frameRead = written + 1;
+    profiler.frameStart = now;
+}
+
+// Frame times of the last PROFILE_FRAMES frames as bars, with the average and worst time of
+// every main thread zone below them, nested zones indented
+void ProfilerDrawOverlay(int x, int y) {
+    if (!profiler.enabled) return;
+
+    int width = PROFILE_FRAMES * 2;
+    int graphHeight = 60;
+    int lineHeight = 12;
+    DrawRectangle(x - 4, y - 4, width + 8, graphHeight + 24 + profiler.zoneCount * lineHeight, (Color){ 0, 0, 0, 160 });
+
+    // Bars fill the graph at 33.3 ms, the 16.7 ms line marks a 60 fps frame
+    float scale = graphHeight / 33.3f;
+    for (int i = 0; i < PROFILE_FRAMES; i++) {
+        float ms = profiler.frameMs[(profiler.frame + 1 + i) % PROFILE_FRAMES];
+        int height = (int)fminf(ms * scale, (float)graphHeight);
+        DrawRectangle(x + i * 2, y + graphHeight - height, 2, height, ms > 16.7f ? RED : GREEN);
+    }
+    DrawLine(x, y + graphHeight - (int)(16.7f * scale), x + width, y + graphHeight - (int)(16.7f * scale), YELLOW);
+    DrawText(TextFormat("frame %.2f ms", profiler.frameMs[profiler.frame]), x, y + graphHeight + 4, 10, WHITE);
+
+    for (int i = 0; i < profiler.zoneCount; i++) {
+        ProfileZoneHistory *zone = &profiler.zones[i];
+        float total = 0, worst = 0;
+        for (int f = 0; f < PROFILE_FRAMES; f++) {
+            total += zone->ms[f];
+            worst = fmaxf(worst, zone->ms[f]);
+        }
+
+        int indent = zone->depth > 0 ? zone->depth * 8 : 0;
+        DrawText(TextFormat("%-24s %6.3f %6.3f", zone->name, total / PROFILE_FRAMES, worst), x + indent, y + graphHeight + 18 + i * lineHeight, 10, WHITE);
+    }
+}
+
+// Writes the recorded events of every thread as Chrome trace JSON. Rings are copied before
+// writing, and events overwritten while copying are dropped.
+bool ProfilerDumpTrace(const char *fileName) {
+    FILE *file = fopen(fileName, "wb");
+    if (file == NULL) return false;
+
+    ProfileEvent *events = (ProfileEvent *)malloc(PROFILE_EVENTS * sizeof(ProfileEvent));
+    int threadCount = atomic_load(&profiler.threadCount);
+    if (threadCount > PROFILE_MAX_THREADS) threadCount = PROFILE_MAX_THREADS;
+
+    // Timestamps start at the oldest event so they stay readable
+    uint64_t origin = UINT64_MAX;
+    for (int t = 0; t < threadCount; t++) {
+        ProfileThread *thread = profiler.threads[t];
+        if (thread == NULL) continue;
+        uint32_t written = atomic_load_explicit(&thread->written, memory_order_acquire);
+        uint32_t first = written > PROFILE_EVENTS ? written - PROFILE_EVENTS : 0;
+        for (uint32_t i = first; i != written; i++) {
+            uint64_t start = thread->events[i & (PROFILE_EVENTS - 1)].start;
+            if (start < origin) origin = start;
+        }
+    }
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+
+    for (int t = 0; t < threadCount; t++) {
+        ProfileThread *thread = profiler.threads[t];
+        if (thread == NULL) continue;
+
+        uint32_t written = atomic_load_explicit(&thread->written, memory_order_acquire);
+        memcpy(events, thread->events, sizeof(thread->events));
+        uint32_t after = atomic_load_explicit(&thread->written, memory_order_acquire);
+
+        // Slots the thread wrote into during the copy, or is writing now, hold a mix of old and new events
+        uint32_t oldest = after >= PROFILE_EVENTS ? after - PROFILE_EVENTS + 1 : 0;
+
+        const char *name = thread->name ? thread->name : "Thread";
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", t, name);
+        first = false;
+
+        for (uint32_t i = oldest; i != written; i++) {
+            ProfileEvent *event = &events[i & (PROFILE_EVENTS - 1)];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                event->name, t, (event->start - origin) / 1e3, (event->end - event->start) / 1e3);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    free(events);
+    return fclose(file) == 0;
+}
\ No newline at end of file
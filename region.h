@@ -0,0 +1,345 @@
+// Region files hold REGION_SIZE^3 chunks each, every chunk compressed on its own with codec.h.
+// Layout: header with magic, version, dimensions and a table of (offset, size, CRC32C) per chunk,
+// then the chunk data. A size of 0 means the chunk was never saved. Fields are little endian.
+// A chunk is checked against its CRC when it loads, so a damaged chunk costs only itself.
+// Chunk blocks are in ChunkIndex order. Versions 1 and 2 stored them tiled by section and are
+// reordered as they load.
+
+#define REGION_SHIFT 2
+#define REGION_SIZE (1 << REGION_SHIFT)
+#define REGION_CHUNKS (REGION_SIZE * REGION_SIZE * REGION_SIZE)
+
+#define REGION_MAGIC 0x47525856  // "VXRG"
+#define REGION_VERSION 3
+
+typedef struct {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t crc;  // CRC32C of the chunk bytes
+} RegionEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t chunkSize;   // Blocks along a chunk edge
+    uint32_t regionSize;  // Chunks along a region edge
+    RegionEntry chunks[REGION_CHUNKS];
+} RegionHeader;
+
+// Version 1 had neither dimensions nor checksums, its chunks load unchecked
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    struct { uint32_t offset, size; } chunks[REGION_CHUNKS];
+} RegionHeaderV1;
+
+// Reads the header of a region file of any version into the current layout. Fails for other files,
+// newer versions and regions saved with different dimensions.
+bool ReadRegionHeader(const unsigned char *data, size_t size, RegionHeader *header) {
+    if (size < 2 * sizeof(uint32_t)) return false;
+    memcpy(header, data, 2 * sizeof(uint32_t));
+    if (header->magic != REGION_MAGIC) return false;
+
+    if (header->version == 1 && size >= sizeof(RegionHeaderV1)) {
+        const RegionHeaderV1 *old = (const RegionHeaderV1 *)data;
+        header->chunkSize = CHUNK_SIZE;
+        header->regionSize = REGION_SIZE;
+        for (int i = 0; i < REGION_CHUNKS; i++) {
+            header->chunks[i] = (RegionEntry){ old->chunks[i].offset, old->chunks[i].size, 0 };
+        }
+        return true;
+    }
+
+    if (header->version < 2 || header->version > REGION_VERSION || size < sizeof(RegionHeader)) return false;
+    memcpy(header, data, sizeof(RegionHeader));
+    return header->chunkSize == CHUNK_SIZE && header->regionSize == REGION_SIZE;
+}
+
+// Whether a chunk's bytes match its table entry. Version 1 chunks have nothing to check against.
+static inline bool RegionChunkIntact(const RegionHeader *header, int index, const unsigned char *data) {
+    return header->version < 2 || Crc32c(data, header->chunks[index].size) == header->chunks[index].crc;
+}
+
+static inline int RegionChunkIndex(int cx, int cy, int cz) {
+    int mask = REGION_SIZE - 1;
+    return (cx & mask) + (cy & mask) * REGION_SIZE + (cz & mask) * REGION_SIZE * REGION_SIZE;
+}
+
+void RegionFileName(char *name, int size, int rx, int ry, int rz) {
+    snprintf(name, size, "region.%d.%d.%d", rx, ry, rz);
+}
+
+bool RegionFileExists(int rx, int ry, int rz) {
+    char name[64];
+    RegionFileName(name, sizeof(name), rx, ry, rz);
+
+    FILE *file = fopen(name, "rb");
+    if (file == NULL) return false;
+    fclose(file);
+    return true;
+}
+
+// Region files stay mapped while their chunks load, so streaming a chunk in decodes straight out
+// of the page cache without a read call. The least recently used mapping is dropped when full.
+#define MAX_MAPPED_REGIONS 8
+
+typedef struct {
+    int rx, ry, rz;
+    unsigned int lastUse;
+    MappedFile file;
+    RegionHeader header;
+} MappedRegion;
+
+typedef struct {
+    MappedRegion regions[MAX_MAPPED_REGIONS];
+    unsigned int clock;
+} RegionCache;
+
+RegionCache regionCache = { 0 };
+
+// Returns the mapped region file, NULL when it is missing or not a region file
+const MappedRegion *MapRegion(int rx, int ry, int rz) {
+    MappedRegion *slot = &regionCache.regions[0];
+    regionCache.clock++;
+
+    for (int i = 0; i < MAX_MAPPED_REGIONS; i++) {
+        MappedRegion *region = &regionCache.regions[i];
+        if (region->file.data != NULL && region->rx == rx && region->ry == ry && region->rz == rz) {
+            region->lastUse = regionCache.clock;
+            return region;
+        }
+        if (region->file.data == NULL || (slot->file.data != NULL && region->lastUse < slot->lastUse)) slot = region;
+    }
+
+    char name[64];
+    RegionFileName(name, sizeof(name), rx, ry, rz);
+
+    MappedFile file;
+    if (!MapFile(&file, name)) return NULL;
+
+    RegionHeader header;
+    if (!ReadRegionHeader(file.data, file.size, &header)) {
+        printf("%s is not a region file this version can read, its chunks are generated again\n", name);
+        UnmapFile(&file);
+        return NULL;
+    }
+
+    UnmapFile(&slot->file);
+    *slot = (MappedRegion){ rx, ry, rz, regionCache.clock, file, header };
+    return slot;
+}
+
+// Drops the mapping of a region before its file is rewritten
+void UnmapRegion(int rx, int ry, int rz) {
+    for (int i = 0; i < MAX_MAPPED_REGIONS; i++) {
+        MappedRegion *region = &regionCache.regions[i];
+        if (region->file.data != NULL && region->rx == rx && region->ry == ry && region->rz == rz) {
+            UnmapFile(&region->file);
+        }
+    }
+}
+
+void UnmapAllRegions() {
+    for (int i = 0; i < MAX_MAPPED_REGIONS; i++) {
+        UnmapFile(&regionCache.regions[i].file);
+    }
+}
+
+// Versions 1 and 2 stored the 16^3 blocks of each section one after another, x fastest, sections in
+// SectionIndex order
+static void UntileChunkBlocks(PackedBlocks *blocks) {
+    int *tiled = (int*)malloc(CHUNK_VOLUME * sizeof(int));
+    int *ids = (int*)malloc(CHUNK_VOLUME * sizeof(int));
+    PackedBlocksGetRun(blocks, 0, CHUNK_VOLUME, tiled);
+
+    int mask = SECTION_SIZE - 1;
+    for (int i = 0; i < CHUNK_VOLUME; i++) {
+        int section = i >> (3 * SECTION_SHIFT);
+        int x = (section % SECTIONS_PER_AXIS) << SECTION_SHIFT | (i & mask);
+        int y = (section / SECTIONS_PER_AXIS % SECTIONS_PER_AXIS) << SECTION_SHIFT | (i >> SECTION_SHIFT & mask);
+        int z = (section / (SECTIONS_PER_AXIS * SECTIONS_PER_AXIS)) << SECTION_SHIFT | (i >> (2 * SECTION_SHIFT) & mask);
+        ids[ChunkIndex(x, y, z)] = tiled[i];
+    }
+
+    PackedBlocksFree(blocks);
+    PackedBlocksFromArray(blocks, ids, CHUNK_VOLUME);
+    free(tiled);
+    free(ids);
+}
+
+// DecodeBlocks for a chunk of a region file with the given header
+static bool DecodeRegionChunk(const RegionHeader *header, const unsigned char *data, size_t size, PackedBlocks *blocks) {
+    if (!DecodeBlocks(data, size, blocks, CHUNK_VOLUME)) return false;
+    if (header->version < 3) UntileChunkBlocks(blocks);
+    return true;
+}
+
+// Bytes of one chunk in a mapped region, NULL when the chunk was never saved, the table points
+// outside the file or the bytes fail their checksum. Only this chunk's bytes are read.
+const unsigned char *RegionChunkData(const MappedRegion *region, int index, size_t *size) {
+    RegionEntry entry = region->header.chunks[index];
+    if (entry.size == 0 || entry.offset > region->file.size || entry.size > region->file.size - entry.offset) return NULL;
+
+    const unsigned char *data = region->file.data + entry.offset;
+    if (!RegionChunkIntact(&region->header, index, data)) return NULL;
+
+    *size = entry.size;
+    return data;
+}
+
+// The single 64^3 "world" file of saves from before chunks, ints in x + y * 64 + z * 64 * 64 order.
+// It holds chunk 0, 0, 0 until the region holding that chunk is first written.
+bool LoadLegacyWorld(Chunk *chunk) {
+    FILE *file = fopen("world", "rb");
+    if (file == NULL) return false;
+
+    int *ids = (int*)malloc(CHUNK_VOLUME * sizeof(int));
+    size_t read = fread(ids, sizeof(int), CHUNK_VOLUME, file);
+    fclose(file);
+
+    if (read == CHUNK_VOLUME) {
+        int *blocks = (int*)malloc(CHUNK_VOLUME * sizeof(int));
+        for (int i = 0; i < CHUNK_VOLUME; i++) {
+            blocks[ChunkIndex(i % CHUNK_SIZE, i / CHUNK_SIZE % CHUNK_SIZE, i / (CHUNK_SIZE * CHUNK_SIZE))] = ids[i];
+        }
+        PackedBlocksFromArray(&chunk->blocks, blocks, CHUNK_VOLUME);
+        free(blocks);
+    }
+    free(ids);
+    return read == CHUNK_VOLUME;
+}
+
+// Reads one chunk's bytes with plain file reads, for regions that must not stay mapped
+static bool LoadChunkUnmapped(Chunk *chunk) {
+    char name[64];
+    RegionFileName(name, sizeof(name), chunk->cx >> REGION_SHIFT, chunk->cy >> REGION_SHIFT, chunk->cz >> REGION_SHIFT);
+
+    FILE *file = fopen(name, "rb");
+    if (file == NULL) return false;
+
+    bool loaded = false;
+    unsigned char headerData[sizeof(RegionHeader)];
+    size_t headerSize = fread(headerData, 1, sizeof(headerData), file);
+
+    RegionHeader header;
+    if (ReadRegionHeader(headerData, headerSize, &header)) {
+        int index = RegionChunkIndex(chunk->cx, chunk->cy, chunk->cz);
+        RegionEntry entry = header.chunks[index];
+
+        if (entry.size > 0 && fseek(file, entry.offset, SEEK_SET) == 0) {
+            unsigned char *data = (unsigned char*)malloc(entry.size);
+            if (fread(data, 1, entry.size, file) == entry.size && RegionChunkIntact(&header, index, data)) {
+                loaded = DecodeRegionChunk(&header, data, entry.size, &chunk->blocks);
+            }
+            free(data);
+        }
+
+        if (!loaded && entry.size > 0) {
+            printf("Chunk %d %d %d is damaged, generating it again\n", chunk->cx, chunk->cy, chunk->cz);
+        }
+    }
+    fclose(file);
+    return loaded;
+}
+
+// Regions with a save in flight are read without mapping them, since Windows cannot replace
+// a file while a view of it is open. A chunk that fails its checksum or does not decode counts as
+// never saved, so the caller generates it again. The legacy world is only read while chunk 0, 0, 0
+// has no region file at all, a damaged chunk in that region is generated again like any other.
+bool LoadChunkFile(Chunk *chunk, bool mapped) {
+    bool loaded = false;
+
+    if (mapped) {
+        const MappedRegion *region = MapRegion(chunk->cx >> REGION_SHIFT, chunk->cy >> REGION_SHIFT, chunk->cz >> REGION_SHIFT);
+        if (region != NULL) {
+            int index = RegionChunkIndex(chunk->cx, chunk->cy, chunk->cz);
+            size_t size;
+            const unsigned char *data = RegionChunkData(region, index, &size);
+            if (data != NULL) loaded = DecodeRegionChunk(&region->header, data, size, &chunk->blocks);
+
+            if (!loaded && region->header.chunks[index].size > 0) {
+                printf("Chunk %d %d %d is damaged, generating it again\n", chunk->cx, chunk->cy, chunk->cz);
+            }
+        }
+    } else {
+        loaded = LoadChunkUnmapped(chunk);
+    }
+
+    if (!loaded && chunk->cx == 0 && chunk->cy == 0 && chunk->cz == 0 && !RegionFileExists(0, 0, 0)) {
+        loaded = LoadLegacyWorld(chunk);
+    }
+    return loaded;
+}
+
+// Blocks of one chunk as they were when a save was requested
+typedef struct {
+    int cx, cy, cz;
+    PackedBlocks blocks;
+} ChunkSnapshot;
+
+// Writes a region with the given chunks, copying the others from the current file. Safe to call off
+// the main thread: it maps the old file itself, writes a temporary file, syncs it to disk and renames
+// it over the old one, so a crash at any point leaves either the old or the new region intact.
+bool WriteRegion(int rx, int ry, int rz, const ChunkSnapshot *chunks, int count) {
+    char name[64];
+    char tempName[72];
+    RegionFileName(name, sizeof(name), rx, ry, rz);
+    snprintf(tempName, sizeof(tempName), "%s.tmp", name);
+
+    // Damaged chunks of the old file are left out rather than copied with a fresh checksum
+    MappedRegion old = { 0 };
+    if (MapFile(&old.file, name) && !ReadRegionHeader(old.file.data, old.file.size, &old.header)) {
+        UnmapFile(&old.file);
+    }
+
+    RegionHeader header = { REGION_MAGIC, REGION_VERSION, CHUNK_SIZE, REGION_SIZE, { { 0 } } };
+    ByteBuffer body = { 0 };
+
+    for (int i = 0; i < REGION_CHUNKS; i++) {
+        int x = rx * REGION_SIZE + i % REGION_SIZE;
+        int y = ry * REGION_SIZE + i / REGION_SIZE % REGION_SIZE;
+        int z = rz * REGION_SIZE + i / (REGION_SIZE * REGION_SIZE);
+        size_t start = body.size;
+
+        const ChunkSnapshot *chunk = NULL;
+        for (int j = 0; j < count; j++) {
+            if (chunks[j].cx == x && chunks[j].cy == y && chunks[j].cz == z) chunk = &chunks[j];
+        }
+
+        if (chunk != NULL) {
+            EncodeBlocks(&chunk->blocks, &body);
+        } else if (old.file.data != NULL) {
+            // Chunks of older versions are written again in the current block order
+            size_t size;
+            const unsigned char *data = RegionChunkData(&old, i, &size);
+            if (data != NULL && old.header.version < 3) {
+                PackedBlocks blocks;
+                if (DecodeRegionChunk(&old.header, data, size, &blocks)) {
+                    EncodeBlocks(&blocks, &body);
+                    PackedBlocksFree(&blocks);
+                }
+            } else if (data != NULL) {
+                ByteBufferPush(&body, data, size);
+            }
+        }
+
+        header.chunks[i].offset = (uint32_t)(sizeof(RegionHeader) + start);
+        header.chunks[i].size = (uint32_t)(body.size - start);
+        if (body.size > start) header.chunks[i].crc = Crc32c(body.data + start, body.size - start);
+    }
+    UnmapFile(&old.file);
+
+    FILE *file = fopen(tempName, "wb");
+    bool written = file != NULL;
+    if (file != NULL) {
+        written = fwrite(&header, sizeof(header), 1, file) == 1;
+        if (body.size > 0) written = written && fwrite(body.data, 1, body.size, file) == body.size;
+        written = written && FileSync(file);
+        written = fclose(file) == 0 && written;
+    }
+    ByteBufferFree(&body);
+
+    if (written) written = FileReplace(tempName, name);
+    if (!written) remove(tempName);
+    return written;
+}
\ No newline at end of file
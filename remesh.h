@@ -0,0 +1,203 @@
+// Background section meshing. The main thread snapshots sections and submits them, workers build
+// the vertex buffers, and finished results are handed back for upload on the main thread.
+
+#define MAX_MESH_WORKERS 4
+
+typedef struct RemeshJob {
+    // World section coordinates, and the chunk instance the snapshot was taken from
+    int sx, sy, sz;
+    unsigned int loadId;
+    unsigned int version;
+    // Owner's pointer to this job while it waits, cleared when a worker takes it
+    struct RemeshJob **slot;
+    bool cancelled;
+    // Taken before the queue is locked, so a newer edit only swaps the pointer
+    SectionSnapshot *snapshot;
+} RemeshJob;
+
+typedef struct {
+    int sx, sy, sz;
+    unsigned int loadId;
+    unsigned int version;
+    SectionMeshInfo info;
+    Quad *quads;
+} RemeshResult;
+
+typedef struct {
+    Mutex mutex;
+    CondVar jobReady;
+    bool running;
+
+    // Jobs in submission order. At most one waits per section, a newer edit replaces its snapshot in place.
+    RemeshJob **jobs;
+    int jobHead;
+    int jobCount;
+    int jobCapacity;
+
+    RemeshResult *results;
+    int resultCount;
+    int resultCapacity;
+
+    Thread workers[MAX_MESH_WORKERS];
+    int workerCount;
+} RemeshQueue;
+
+void RemeshWorker(void *arg) {
+    RemeshQueue *queue = (RemeshQueue *)arg;
+    GreedyMesher *mesher = (GreedyMesher *)malloc(sizeof(GreedyMesher));
+    MeshArena arena = newMeshArena(MAX_SECTION_QUADS + MAX_SECTION_SPRITE_QUADS);
+    ProfileThreadName("Remesh worker");
+
+    MutexLock(&queue->mutex);
+    while (true) {
+        while (queue->running && queue->jobCount == 0) {
+            CondWait(&queue->jobReady, &queue->mutex);
+        }
+        if (!queue->running) break;
+
+        RemeshJob *job = queue->jobs[queue->jobHead];
+        queue->jobHead = (queue->jobHead + 1) % queue->jobCapacity;
+        queue->jobCount--;
+
+        if (job->cancelled) {
+            free(job->snapshot);
+            free(job);
+            continue;
+        }
+        *job->slot = NULL;
+        MutexUnlock(&queue->mutex);
+
+        // Emit into the worker's arena, then copy into a vertex buffer of the exact size
+        ProfileZone zone = ProfileBegin("Remesh");
+        RemeshResult result = { job->sx, job->sy, job->sz, job->loadId, job->version, { 0 }, NULL };
+        resetMeshArena(&arena);
+        result.info = CountSectionMesh(mesher, job->snapshot);
+        result.info.quads = EmitSectionMesh(mesher, job->snapshot, &arena);
+
+        if (arena.count > 0) {
+            result.quads = (Quad *)malloc(arena.count * sizeof(Quad));
+            memcpy(result.quads, arena.quads, arena.count * sizeof(Quad));
+        }
+        free(job->snapshot);
+        free(job);
+        ProfileEnd(&zone);
+
+        MutexLock(&queue->mutex);
+        if (queue->resultCount == queue->resultCapacity) {
+            queue->resultCapacity = queue->resultCapacity ? queue->resultCapacity * 2 : 64;
+            queue->results = (RemeshResult *)realloc(queue->results, queue->resultCapacity * sizeof(RemeshResult));
+        }
+        queue->results[queue->resultCount++] = result;
+    }
+    MutexUnlock(&queue->mutex);
+
+    freeMeshArena(&arena);
+    free(mesher);
+}
+
+void RemeshQueueInit(RemeshQueue *queue) {
+    memset(queue, 0, sizeof(RemeshQueue));
+    MutexInit(&queue->mutex);
+    CondInit(&queue->jobReady);
+    queue->running = true;
+
+    // Leave one core for the render thread
+    queue->workerCount = GetCPUCount() - 1;
+    if (queue->workerCount < 1) queue->workerCount = 1;
+    if (queue->workerCount > MAX_MESH_WORKERS) queue->workerCount = MAX_MESH_WORKERS;
+
+    for (int i = 0; i < queue->workerCount; i++) {
+        ThreadCreate(&queue->workers[i], RemeshWorker, queue);
+    }
+}
+
+void RemeshQueueShutdown(RemeshQueue *queue) {
+    MutexLock(&queue->mutex);
+    queue->running = false;
+    CondBroadcast(&queue->jobReady);
+    MutexUnlock(&queue->mutex);
+
+    for (int i = 0; i < queue->workerCount; i++) {
+        ThreadJoin(queue->workers[i]);
+    }
+
+    for (int i = 0; i < queue->jobCount; i++) {
+        RemeshJob *job = queue->jobs[(queue->jobHead + i) % queue->jobCapacity];
+        if (!job->cancelled) *job->slot = NULL;
+        free(job->snapshot);
+        free(job);
+    }
+    free(queue->jobs);
+    for (int i = 0; i < queue->resultCount; i++) free(queue->results[i].quads);
+    free(queue->results);
+
+    CondDestroy(&queue->jobReady);
+    MutexDestroy(&queue->mutex);
+}
+
+// Snapshots a section of the world on the calling thread and queues it for meshing. slot is where
+// the caller keeps the section's waiting job, so repeated edits reuse it instead of queueing again.
+// The snapshot is taken before locking so workers are not held up while a chunk load submits its sections.
+void RemeshQueueSubmit(RemeshQueue *queue, const ChunkMap *map, RemeshJob **slot, unsigned int loadId, unsigned int version, int sx, int sy, int sz) {
+    SectionSnapshot *snapshot = (SectionSnapshot *)malloc(sizeof(SectionSnapshot));
+    TakeSectionSnapshot(snapshot, map, sx, sy, sz);
+
+    MutexLock(&queue->mutex);
+    RemeshJob *job = *slot;
+    if (job == NULL) {
+        if (queue->jobCount == queue->jobCapacity) {
+            int capacity = queue->jobCapacity ? queue->jobCapacity * 2 : 256;
+            RemeshJob **jobs = (RemeshJob **)malloc(capacity * sizeof(RemeshJob *));
+            for (int i = 0; i < queue->jobCount; i++) {
+                jobs[i] = queue->jobs[(queue->jobHead + i) % queue->jobCapacity];
+            }
+            free(queue->jobs);
+            queue->jobs = jobs;
+            queue->jobHead = 0;
+            queue->jobCapacity = capacity;
+        }
+
+        job = (RemeshJob *)malloc(sizeof(RemeshJob));
+        job->slot = slot;
+        job->cancelled = false;
+        job->snapshot = NULL;
+        *slot = job;
+        queue->jobs[(queue->jobHead + queue->jobCount) % queue->jobCapacity] = job;
+        queue->jobCount++;
+        CondSignal(&queue->jobReady);
+    }
+
+    job->sx = sx;
+    job->sy = sy;
+    job->sz = sz;
+    job->loadId = loadId;
+    job->version = version;
+    SectionSnapshot *replaced = job->snapshot;
+    job->snapshot = snapshot;
+    MutexUnlock(&queue->mutex);
+
+    free(replaced);
+}
+
+// Drops a waiting job before its section goes away, a job already taken by a worker is
+// filtered out on upload instead
+void RemeshQueueCancel(RemeshQueue *queue, RemeshJob **slot) {
+    MutexLock(&queue->mutex);
+    if (*slot != NULL) {
+        (*slot)->cancelled = true;
+        *slot = NULL;
+    }
+    MutexUnlock(&queue->mutex);
+}
+
+// Moves finished results into the caller's buffer, returns how many were taken
+int RemeshQueuePoll(RemeshQueue *queue, RemeshResult *out, int maxResults) {
+    MutexLock(&queue->mutex);
+    int count = queue->resultCount < maxResults ? queue->resultCount : maxResults;
+    memcpy(out, queue->results, count * sizeof(RemeshResult));
+    memmove(queue->results, queue->results + count, (queue->resultCount - count) * sizeof(RemeshResult));
+    queue->resultCount -= count;
+    MutexUnlock(&queue->mutex);
+
+    return count;
+}
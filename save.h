@@ -0,0 +1,181 @@
+// Background region saving. The main thread takes copy-on-write snapshots of a region's loaded
+// chunks, which costs a reference count per chunk, and a worker encodes and writes the region.
+// Jobs stay listed until the main thread collects them, so a chunk unloaded with a save in flight
+// is reloaded from its snapshot rather than from the file that has not been replaced yet.
+
+typedef struct SaveJob {
+    int rx, ry, rz;
+    int count;
+    ChunkSnapshot chunks[REGION_CHUNKS];
+    bool done;
+    bool failed;
+    struct SaveJob *next;
+} SaveJob;
+
+typedef struct {
+    Mutex mutex;
+    CondVar jobReady;
+    bool running;
+
+    // Oldest first, the worker writes them in order
+    SaveJob *head;
+    SaveJob *tail;
+
+    Thread worker;
+} SaveQueue;
+
+void SaveWorker(void *arg) {
+    SaveQueue *queue = (SaveQueue *)arg;
+    ProfileThreadName("Save worker");
+
+    MutexLock(&queue->mutex);
+    while (true) {
+        SaveJob *job = queue->head;
+        while (job != NULL && job->done) job = job->next;
+
+        if (job == NULL) {
+            // Pending saves are finished before shutting down
+            if (!queue->running) break;
+            CondWait(&queue->jobReady, &queue->mutex);
+            continue;
+        }
+        MutexUnlock(&queue->mutex);
+
+        ProfileZone zone = ProfileBegin("WriteRegion");
+        bool written = WriteRegion(job->rx, job->ry, job->rz, job->chunks, job->count);
+        ProfileEnd(&zone);
+
+        MutexLock(&queue->mutex);
+        job->done = true;
+        job->failed = !written;
+    }
+    MutexUnlock(&queue->mutex);
+}
+
+void SaveQueueInit(SaveQueue *queue) {
+    memset(queue, 0, sizeof(SaveQueue));
+    MutexInit(&queue->mutex);
+    CondInit(&queue->jobReady);
+    queue->running = true;
+    ThreadCreate(&queue->worker, SaveWorker, queue);
+}
+
+// Snapshots every loaded chunk of the region holding chunk cx, cy, cz and queues the region for writing
+void SaveQueueSubmit(SaveQueue *queue, ChunkMap *map, int cx, int cy, int cz) {
+    SaveJob *job = (SaveJob *)calloc(1, sizeof(SaveJob));
+    job->rx = cx >> REGION_SHIFT;
+    job->ry = cy >> REGION_SHIFT;
+    job->rz = cz >> REGION_SHIFT;
+
+    for (int i = 0; i < REGION_CHUNKS; i++) {
+        int x = job->rx * REGION_SIZE + i % REGION_SIZE;
+        int y = job->ry * REGION_SIZE + i / REGION_SIZE % REGION_SIZE;
+        int z = job->rz * REGION_SIZE + i / (REGION_SIZE * REGION_SIZE);
+
+        Chunk *chunk = ChunkMapGet(map, x, y, z);
+        if (chunk == NULL) continue;
+
+        ChunkSnapshot *snapshot = &job->chunks[job->count++];
+        snapshot->cx = x;
+        snapshot->cy = y;
+        snapshot->cz = z;
+        PackedBlocksShare(&chunk->blocks, &snapshot->blocks);
+        chunk->dirty = false;
+    }
+
+    // The worker replaces the file, so the main thread must not keep it mapped
+    UnmapRegion(job->rx, job->ry, job->rz);
+
+    MutexLock(&queue->mutex);
+    if (queue->tail) queue->tail->next = job;
+    else queue->head = job;
+    queue->tail = job;
+    CondSignal(&queue->jobReady);
+    MutexUnlock(&queue->mutex);
+}
+
+bool SaveQueueRegionPending(SaveQueue *queue, int rx, int ry, int rz) {
+    bool pending = false;
+
+    MutexLock(&queue->mutex);
+    for (SaveJob *job = queue->head; job != NULL; job = job->next) {
+        if (job->rx == rx && job->ry == ry && job->rz == rz) pending = true;
+    }
+    MutexUnlock(&queue->mutex);
+
+    return pending;
+}
+
+// True once every queued save has been written and collected
+bool SaveQueueIdle(SaveQueue *queue) {
+    MutexLock(&queue->mutex);
+    bool idle = queue->head == NULL;
+    MutexUnlock(&queue->mutex);
+    return idle;
+}
+
+// Shares the newest snapshot of a chunk that is still being saved into blocks
+bool SaveQueueFind(SaveQueue *queue, int cx, int cy, int cz, PackedBlocks *blocks) {
+    ChunkSnapshot *found = NULL;
+
+    MutexLock(&queue->mutex);
+    for (SaveJob *job = queue->head; job != NULL; job = job->next) {
+        for (int i = 0; i < job->count; i++) {
+            ChunkSnapshot *snapshot = &job->chunks[i];
+            if (snapshot->cx == cx && snapshot->cy == cy && snapshot->cz == cz) found = snapshot;
+        }
+    }
+    if (found != NULL) PackedBlocksShare(&found->blocks, blocks);
+    MutexUnlock(&queue->mutex);
+
+    return found != NULL;
+}
+
+static void FreeSaveJob(SaveJob *job) {
+    for (int i = 0; i < job->count; i++) {
+        PackedBlocksFree(&job->chunks[i].blocks);
+    }
+    free(job);
+}
+
+// Collects finished saves. A failed region marks its still loaded chunks dirty again so the next
+// save retries them. Returns how many regions failed.
+int SaveQueuePoll(SaveQueue *queue, ChunkMap *map) {
+    int failures = 0;
+
+    MutexLock(&queue->mutex);
+    while (queue->head != NULL && queue->head->done) {
+        SaveJob *job = queue->head;
+        queue->head = job->next;
+        if (queue->head == NULL) queue->tail = NULL;
+
+        // A mapping taken while the save ran may show the replaced file
+        UnmapRegion(job->rx, job->ry, job->rz);
+
+        if (job->failed) {
+            failures++;
+            for (int i = 0; i < job->count; i++) {
+                Chunk *chunk = ChunkMapGet(map, job->chunks[i].cx, job->chunks[i].cy, job->chunks[i].cz);
+                if (chunk != NULL) chunk->dirty = true;
+            }
+        }
+        FreeSaveJob(job);
+    }
+    MutexUnlock(&queue->mutex);
+
+    return failures;
+}
+
+// Waits for every queued save to be written
+void SaveQueueShutdown(SaveQueue *queue, ChunkMap *map) {
+    MutexLock(&queue->mutex);
+    queue->running = false;
+    CondBroadcast(&queue->jobReady);
+    MutexUnlock(&queue->mutex);
+
+    ThreadJoin(queue->worker);
+    SaveQueuePoll(queue, map);
+
+    CondDestroy(&queue->jobReady);
+    MutexDestroy(&queue->mutex);
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+// Sparse registry of sprite blocks (negative ids), so drawing them scales with the number of sprites
+// instead of the world volume. Order is not kept, removal swaps in the last entry.
+typedef struct {
+    int *blocks;
+    int count;
+    int capacity;
+} SpriteList;
+
+void SpriteListAdd(SpriteList *list, int blockID) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        list->blocks = (int*)realloc(list->blocks, list->capacity * sizeof(int));
+    }
+    list->blocks[list->count++] = blockID;
+}
+
+void SpriteListRemove(SpriteList *list, int blockID) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->blocks[i] == blockID) {
+            list->blocks[i] = list->blocks[--list->count];
+            return;
+        }
+    }
+}
+
+void SpriteListClear(SpriteList *list) {
+    list->count = 0;
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+// Minimal threading wrappers over Win32 and pthreads
+
+#if defined(_WIN32)
+    // Keep windows.h from declaring names that clash with raylib
+    #define WIN32_LEAN_AND_MEAN
+    #define NOGDI
+    #define NOUSER
+    #include <windows.h>
+
+    typedef HANDLE Thread;
+    typedef CRITICAL_SECTION Mutex;
+    typedef CONDITION_VARIABLE CondVar;
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+
+    typedef pthread_t Thread;
+    typedef pthread_mutex_t Mutex;
+    typedef pthread_cond_t CondVar;
+#endif
+
+typedef void (*ThreadFunc)(void *arg);
+
+typedef struct {
+    ThreadFunc func;
+    void *arg;
+} ThreadStart;
+
+#if defined(_WIN32)
+static DWORD WINAPI ThreadEntry(LPVOID param) {
+    ThreadStart start = *(ThreadStart *)param;
+    free(param);
+    start.func(start.arg);
+    return 0;
+}
+#else
+static void *ThreadEntry(void *param) {
+    ThreadStart start = *(ThreadStart *)param;
+    free(param);
+    start.func(start.arg);
+    return NULL;
+}
+#endif
+
+void ThreadCreate(Thread *thread, ThreadFunc func, void *arg) {
+    ThreadStart *start = (ThreadStart *)malloc(sizeof(ThreadStart));
+    start->func = func;
+    start->arg = arg;
+#if defined(_WIN32)
+    *thread = CreateThread(NULL, 0, ThreadEntry, start, 0, NULL);
+#else
+    pthread_create(thread, NULL, ThreadEntry, start);
+#endif
+}
+
+void ThreadJoin(Thread thread) {
+#if defined(_WIN32)
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+int GetCPUCount() {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+void MutexInit(Mutex *mutex) {
+#if defined(_WIN32)
+    InitializeCriticalSection(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+void MutexDestroy(Mutex *mutex) {
+#if defined(_WIN32)
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+void MutexLock(Mutex *mutex) {
+#if defined(_WIN32)
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+void MutexUnlock(Mutex *mutex) {
+#if defined(_WIN32)
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+void CondInit(CondVar *cond) {
+#if defined(_WIN32)
+    InitializeConditionVariable(cond);
+#else
+    pthread_cond_init(cond, NULL);
+#endif
+}
+
+void CondDestroy(CondVar *cond) {
+#if defined(_WIN32)
+    (void)cond;
+#else
+    pthread_cond_destroy(cond);
+#endif
+}
+
+void CondWait(CondVar *cond, Mutex *mutex) {
+#if defined(_WIN32)
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+#else
+    pthread_cond_wait(cond, mutex);
+#endif
+}
+
+void CondSignal(CondVar *cond) {
+#if defined(_WIN32)
+    WakeConditionVariable(cond);
+#else
+    pthread_cond_signal(cond);
+#endif
+}
+
+void CondBroadcast(CondVar *cond) {
+#if defined(_WIN32)
+    WakeAllConditionVariable(cond);
+#else
+    pthread_cond_broadcast(cond);
+#endif
+}
@@ -0,0 +1,44 @@
+// Fixed rate simulation clock. Each frame adds its real duration and the simulation catches up in
+// whole ticks of the same length, so physics does not depend on the frame rate. Rendering blends
+// the last two ticks by FixedTimestepAlpha.
+//
+// A frame that took longer than SIMULATION_MAX_STEPS ticks only runs that many and drops the rest,
+// otherwise a slow tick would make the next frame slower still.
+
+#ifndef SIMULATION_HZ
+    #define SIMULATION_HZ 60
+#endif
+#define SIMULATION_MAX_STEPS 8
+
+typedef struct {
+    double step;         // Seconds per tick
+    double accumulator;  // Real time not simulated yet, less than step after FixedTimestepAdvance
+    uint64_t ticks;
+    double dropped;      // Seconds skipped by the SIMULATION_MAX_STEPS limit
+} FixedTimestep;
+
+void FixedTimestepInit(FixedTimestep *clock, int rate) {
+    *clock = (FixedTimestep){ 0 };
+    clock->step = 1.0 / rate;
+}
+
+// Adds a frame's duration and returns the number of ticks to run for it
+int FixedTimestepAdvance(FixedTimestep *clock, double frameTime) {
+    clock->accumulator += frameTime;
+
+    int steps = (int)(clock->accumulator / clock->step);
+    if (steps > SIMULATION_MAX_STEPS) {
+        clock->dropped += (steps - SIMULATION_MAX_STEPS) * clock->step;
+        clock->accumulator -= (steps - SIMULATION_MAX_STEPS) * clock->step;
+        steps = SIMULATION_MAX_STEPS;
+    }
+
+    clock->accumulator -= steps * clock->step;
+    clock->ticks += steps;
+    return steps;
+}
+
+// How far real time is past the last tick, from 0 to 1 of a tick
+float FixedTimestepAlpha(const FixedTimestep *clock) {
+    return (float)(clock->accumulator / clock->step);
+}
\ No newline at end of file
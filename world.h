@@ -0,0 +1,352 @@
+// Unbounded world made of CHUNK_SIZE^3 chunks kept in an open addressing hash map keyed by chunk
+// coordinates. All block access goes through GetBlock and SetBlock, which remember the last chunk
+// used on each thread so runs of nearby lookups skip the hash probe.
+
+#include <stdbool.h>
+
+#define CHUNK_SIZE 64
+#define CHUNK_SHIFT 6
+#define CHUNK_VOLUME (CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE)
+
+#define SECTION_SIZE 16
+#define SECTION_SHIFT 4
+#define SECTIONS_PER_AXIS (CHUNK_SIZE / SECTION_SIZE)
+// Shift from world section coordinates to chunk coordinates
+#define CHUNK_SECTION_SHIFT (CHUNK_SHIFT - SECTION_SHIFT)
+#define SECTION_COUNT (SECTIONS_PER_AXIS * SECTIONS_PER_AXIS * SECTIONS_PER_AXIS)
+#define SECTION_VOLUME (SECTION_SIZE * SECTION_SIZE * SECTION_SIZE)
+
+// Bricks are the finer occupancy level, 4^3 blocks, 64 of them to a section
+#define BRICK_SIZE 4
+#define BRICK_SHIFT 2
+#define SECTION_BRICK_SHIFT (SECTION_SHIFT - BRICK_SHIFT)
+
+// Light levels run from 0 to LIGHT_MAX. A block keeps its sky light in the high nibble of its light
+// byte and the light given off by glowing blocks in the low one, light.h fills them in.
+#define LIGHT_MAX 15
+#define LIGHT_SKY_SHIFT 4
+
+typedef struct Chunk {
+    int cx, cy, cz;
+    // Unique per loaded chunk instance, so work queued for an unloaded chunk is not applied to its reload
+    unsigned int loadId;
+    bool dirty;
+    PackedBlocks blocks;
+    SpriteList sprites[SECTION_COUNT];
+    // Occupancy mips for ray casts: bit b of occupancy[s] is set when brick b of section s holds
+    // anything but air, so a section is empty when its word is 0
+    uint64_t occupancy[SECTION_COUNT];
+    // Sky and block light per section, through ChunkGetLight and ChunkSetLight. A section whose blocks
+    // all have the same light, like open sky or solid ground, has no array and keeps the byte in
+    // uniformLight, the others SECTION_VOLUME bytes in SectionOffsetOfBlock order.
+    uint8_t *light[SECTION_COUNT];
+    uint8_t uniformLight[SECTION_COUNT];
+    // Bit s is set while section s waits in a LightEngine's list of relit sections and has not been
+    // remeshed since its light changed
+    uint64_t relit;
+    struct ChunkRender *render;
+} Chunk;
+
+typedef struct {
+    int cx, cy, cz;
+    Chunk *chunk;
+} ChunkSlot;
+
+typedef struct {
+    ChunkSlot *slots;
+    int capacity;
+    int count;
+    // Bumped whenever chunks are added or removed, invalidating the per-thread lookup caches
+    unsigned int generation;
+    unsigned int nextLoadId;
+} ChunkMap;
+
+typedef struct {
+    const ChunkMap *map;
+    unsigned int generation;
+    int cx, cy, cz;
+    Chunk *chunk;
+} ChunkCache;
+
+static _Thread_local ChunkCache chunkCache = { 0 };
+
+static inline int SectionIndex(int sx, int sy, int sz) {
+    return sx + sy * SECTIONS_PER_AXIS + sz * SECTIONS_PER_AXIS * SECTIONS_PER_AXIS;
+}
+
+// Order of blocks inside a chunk, x + y * 64 + z * 64 * 64. Only ChunkIndex and ChunkPosition know
+// it, everything else goes through them.
+static inline int ChunkIndex(int x, int y, int z) {
+    return x + y * CHUNK_SIZE + z * CHUNK_SIZE * CHUNK_SIZE;
+}
+
+static inline void ChunkPosition(int index, int *x, int *y, int *z) {
+    *x = index % CHUNK_SIZE;
+    *y = index / CHUNK_SIZE % CHUNK_SIZE;
+    *z = index / (CHUNK_SIZE * CHUNK_SIZE);
+}
+
+static inline unsigned int ChunkHash(int cx, int cy, int cz) {
+    return (unsigned int)cx * 73856093u ^ (unsigned int)cy * 19349663u ^ (unsigned int)cz * 83492791u;
+}
+
+void ChunkMapInit(ChunkMap *map, int capacity) {
+    map->slots = (ChunkSlot*)calloc(capacity, sizeof(ChunkSlot));
+    map->capacity = capacity;
+    map->count = 0;
+    map->generation = 1;
+    map->nextLoadId = 1;
+}
+
+Chunk *ChunkMapGet(const ChunkMap *map, int cx, int cy, int cz) {
+    unsigned int mask = map->capacity - 1;
+
+    for (unsigned int i = ChunkHash(cx, cy, cz) & mask;; i = (i + 1) & mask) {
+        const ChunkSlot *slot = &map->slots[i];
+        if (slot->chunk == NULL) return NULL;
+        if (slot->cx == cx && slot->cy == cy && slot->cz == cz) return slot->chunk;
+    }
+}
+
+void ChunkMapInsert(ChunkMap *map, Chunk *chunk) {
+    // Keep the load factor under one half so probe runs stay short
+    if ((map->count + 1) * 2 > map->capacity) {
+        ChunkMap old = *map;
+
+        ChunkMapInit(map, old.capacity * 2);
+        map->generation = old.generation;
+        map->nextLoadId = old.nextLoadId;
+        for (int i = 0; i < old.capacity; i++) {
+            if (old.slots[i].chunk != NULL) ChunkMapInsert(map, old.slots[i].chunk);
+        }
+        free(old.slots);
+    }
+
+    unsigned int mask = map->capacity - 1;
+    unsigned int i = ChunkHash(chunk->cx, chunk->cy, chunk->cz) & mask;
+    while (map->slots[i].chunk != NULL) i = (i + 1) & mask;
+
+    map->slots[i] = (ChunkSlot){ chunk->cx, chunk->cy, chunk->cz, chunk };
+    map->count++;
+    map->generation++;
+}
+
+// Removes a chunk with backward shift deletion, so no tombstones are left behind
+void ChunkMapRemove(ChunkMap *map, int cx, int cy, int cz) {
+    unsigned int mask = map->capacity - 1;
+    unsigned int i = ChunkHash(cx, cy, cz) & mask;
+
+    while (true) {
+        if (map->slots[i].chunk == NULL) return;
+        if (map->slots[i].cx == cx && map->slots[i].cy == cy && map->slots[i].cz == cz) break;
+        i = (i + 1) & mask;
+    }
+
+    unsigned int hole = i;
+    for (unsigned int j = (hole + 1) & mask; map->slots[j].chunk != NULL; j = (j + 1) & mask) {
+        unsigned int home = ChunkHash(map->slots[j].cx, map->slots[j].cy, map->slots[j].cz) & mask;
+
+        // Move the entry back only if its home slot is not between the hole and its current slot
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            map->slots[hole] = map->slots[j];
+            hole = j;
+        }
+    }
+
+    map->slots[hole] = (ChunkSlot){ 0 };
+    map->count--;
+    map->generation++;
+}
+
+static inline Chunk *FindChunk(const ChunkMap *map, int cx, int cy, int cz) {
+    ChunkCache *cache = &chunkCache;
+    if (cache->map == map && cache->generation == map->generation && cache->cx == cx && cache->cy == cy && cache->cz == cz) {
+        return cache->chunk;
+    }
+
+    Chunk *chunk = ChunkMapGet(map, cx, cy, cz);
+    *cache = (ChunkCache){ map, map->generation, cx, cy, cz, chunk };
+    return chunk;
+}
+
+// Blocks in chunks that are not loaded read as air
+static inline int GetBlock(const ChunkMap *map, int x, int y, int z) {
+    Chunk *chunk = FindChunk(map, x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+    if (chunk == NULL) return 0;
+    return PackedBlocksGet(&chunk->blocks, ChunkIndex(x & (CHUNK_SIZE - 1), y & (CHUNK_SIZE - 1), z & (CHUNK_SIZE - 1)));
+}
+
+static inline int ChunkSectionOfBlock(int index) {
+    int x, y, z;
+    ChunkPosition(index, &x, &y, &z);
+    return SectionIndex(x >> SECTION_SHIFT, y >> SECTION_SHIFT, z >> SECTION_SHIFT);
+}
+
+// Place of a block in its section's SECTION_VOLUME arrays, x fastest
+static inline int SectionOffsetOfBlock(int index) {
+    int x, y, z;
+    ChunkPosition(index, &x, &y, &z);
+    int mask = SECTION_SIZE - 1;
+    return (x & mask) | (y & mask) << SECTION_SHIFT | (z & mask) << (2 * SECTION_SHIFT);
+}
+
+static inline uint8_t ChunkGetLight(const Chunk *chunk, int index) {
+    int section = ChunkSectionOfBlock(index);
+    const uint8_t *light = chunk->light[section];
+    return light != NULL ? light[SectionOffsetOfBlock(index)] : chunk->uniformLight[section];
+}
+
+// Gives a uniformly lit section its own array the first time one of its blocks changes
+static inline void ChunkSetLight(Chunk *chunk, int index, uint8_t value) {
+    int section = ChunkSectionOfBlock(index);
+    uint8_t *light = chunk->light[section];
+    if (light == NULL) {
+        if (value == chunk->uniformLight[section]) return;
+        light = chunk->light[section] = (uint8_t*)malloc(SECTION_VOLUME);
+        memset(light, chunk->uniformLight[section], SECTION_VOLUME);
+    }
+    light[SectionOffsetOfBlock(index)] = value;
+}
+
+// Gives every block of a section the same light and drops its array
+void ChunkFillLight(Chunk *chunk, int section, uint8_t value) {
+    free(chunk->light[section]);
+    chunk->light[section] = NULL;
+    chunk->uniformLight[section] = value;
+}
+
+// Drops the array of a section whose blocks have all ended up with the same light
+void ChunkCompactLight(Chunk *chunk, int section) {
+    const uint8_t *light = chunk->light[section];
+    if (light == NULL) return;
+
+    for (int i = 1; i < SECTION_VOLUME; i++) {
+        if (light[i] != light[0]) return;
+    }
+    ChunkFillLight(chunk, section, light[0]);
+}
+
+// Light of blocks in chunks that are not loaded reads as open sky
+static inline uint8_t GetLight(const ChunkMap *map, int x, int y, int z) {
+    Chunk *chunk = FindChunk(map, x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+    if (chunk == NULL) return LIGHT_MAX << LIGHT_SKY_SHIFT;
+    return ChunkGetLight(chunk, ChunkIndex(x & (CHUNK_SIZE - 1), y & (CHUNK_SIZE - 1), z & (CHUNK_SIZE - 1)));
+}
+
+// Bit of the brick holding chunk-local block x, y, z in its section's occupancy word
+static inline uint64_t BrickBit(int x, int y, int z) {
+    int mask = (1 << SECTION_BRICK_SHIFT) - 1;
+    int bx = x >> BRICK_SHIFT & mask;
+    int by = y >> BRICK_SHIFT & mask;
+    int bz = z >> BRICK_SHIFT & mask;
+    return 1ull << (bx | by << SECTION_BRICK_SHIFT | bz << (2 * SECTION_BRICK_SHIFT));
+}
+
+static bool BrickEmpty(const Chunk *chunk, int x, int y, int z) {
+    int ox = x & ~(BRICK_SIZE - 1), oy = y & ~(BRICK_SIZE - 1), oz = z & ~(BRICK_SIZE - 1);
+    for (int bz = oz; bz < oz + BRICK_SIZE; bz++) {
+        for (int by = oy; by < oy + BRICK_SIZE; by++) {
+            for (int bx = ox; bx < ox + BRICK_SIZE; bx++) {
+                if (PackedBlocksGet(&chunk->blocks, ChunkIndex(bx, by, bz)) != 0) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Changes a block and keeps the chunk's sprite registry in sync. Remeshing is left to the caller.
+// Returns false when the chunk is not loaded.
+bool SetBlock(ChunkMap *map, int x, int y, int z, int id) {
+    Chunk *chunk = FindChunk(map, x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+    if (chunk == NULL) return false;
+
+    int lx = x & (CHUNK_SIZE - 1), ly = y & (CHUNK_SIZE - 1), lz = z & (CHUNK_SIZE - 1);
+    int index = ChunkIndex(lx, ly, lz);
+    int section = ChunkSectionOfBlock(index);
+    SpriteList *sprites = &chunk->sprites[section];
+    if (PackedBlocksGet(&chunk->blocks, index) < 0) SpriteListRemove(sprites, index);
+    if (id < 0) SpriteListAdd(sprites, index);
+
+    PackedBlocksSet(&chunk->blocks, index, id);
+    chunk->dirty = true;
+
+    // Removing a block only empties its brick when it was the last one in it
+    if (id != 0) chunk->occupancy[section] |= BrickBit(lx, ly, lz);
+    else if (BrickEmpty(chunk, lx, ly, lz)) chunk->occupancy[section] &= ~BrickBit(lx, ly, lz);
+    return true;
+}
+
+void RebuildChunkSprites(Chunk *chunk) {
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        SpriteListClear(&chunk->sprites[i]);
+    }
+
+    // Most chunks have no sprite ids in their palette at all
+    bool hasSprites = false;
+    for (int i = 0; i < chunk->blocks.paletteCount; i++) {
+        if (chunk->blocks.palette[i] < 0) hasSprites = true;
+    }
+    if (!hasSprites) return;
+
+    int row[CHUNK_SIZE];
+    for (int i = 0; i < CHUNK_VOLUME; i += CHUNK_SIZE) {
+        PackedBlocksGetRun(&chunk->blocks, i, CHUNK_SIZE, row);
+        for (int x = 0; x < CHUNK_SIZE; x++) {
+            if (row[x] < 0) SpriteListAdd(&chunk->sprites[ChunkSectionOfBlock(i + x)], i + x);
+        }
+    }
+}
+
+void RebuildChunkOccupancy(Chunk *chunk) {
+    memset(chunk->occupancy, 0, sizeof(chunk->occupancy));
+
+    // All air is common above and below the terrain
+    if (chunk->blocks.paletteCount == 1 && chunk->blocks.palette[0] == 0) return;
+
+    int row[CHUNK_SIZE];
+    for (int i = 0; i < CHUNK_VOLUME; i += CHUNK_SIZE) {
+        PackedBlocksGetRun(&chunk->blocks, i, CHUNK_SIZE, row);
+        for (int j = 0; j < CHUNK_SIZE; j++) {
+            if (row[j] == 0) continue;
+
+            int x, y, z;
+            ChunkPosition(i + j, &x, &y, &z);
+            chunk->occupancy[SectionIndex(x >> SECTION_SHIFT, y >> SECTION_SHIFT, z >> SECTION_SHIFT)] |= BrickBit(x, y, z);
+        }
+    }
+}
+
+// Flat terrain at y 0-5: stone, then dirt, then grass on top
+void GenerateChunk(Chunk *chunk) {
+    PackedBlocksInit(&chunk->blocks, CHUNK_VOLUME, 0);
+    if (chunk->cy != 0) return;
+
+    for (int x = 0; x < CHUNK_SIZE; x++) {
+        for (int z = 0; z < CHUNK_SIZE; z++) {
+            for (int y = 0; y < 4; y++) {
+                PackedBlocksSet(&chunk->blocks, ChunkIndex(x, y, z), 2);
+            }
+            PackedBlocksSet(&chunk->blocks, ChunkIndex(x, 4, z), 3);
+            PackedBlocksSet(&chunk->blocks, ChunkIndex(x, 5, z), 1);
+        }
+    }
+}
+
+// A chunk with no blocks yet, the caller loads or generates them
+Chunk *NewChunk(ChunkMap *map, int cx, int cy, int cz) {
+    Chunk *chunk = (Chunk*)calloc(1, sizeof(Chunk));
+    chunk->cx = cx;
+    chunk->cy = cy;
+    chunk->cz = cz;
+    chunk->loadId = map->nextLoadId++;
+    return chunk;
+}
+
+void FreeChunk(Chunk *chunk) {
+    PackedBlocksFree(&chunk->blocks);
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        free(chunk->sprites[i].blocks);
+        free(chunk->light[i]);
+    }
+    free(chunk);
+}